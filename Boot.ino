@@ -0,0 +1,112 @@
+/**************************************************
+ * class: Boot
+ * constructor: startBoot()
+ *
+ * setup() only brings up what keeps the heater safe: outputs (already off,
+ * see Watchdog), settings, the watchdog and interlock, the clock and the
+ * checkpoint. It starts a fast 9 bit conversion on the sensor on the way.
+ * The slow rest runs from the loop, a stage per pass. While the conversion
+ * runs: the data log and history, then the banner and settings dump on
+ * Serial, which has to be out before the first telemetry frame. Then bus
+ * enumeration and the first background tasks on the early reading, then
+ * the LCD with its 50ms power-on wait, and last the boot timings, as a
+ * LogSink record between the frames. The first reading, and with it the
+ * interlock and the sensor check, is in about 100ms after a reset instead
+ * of after the whole boot.
+ *
+ * methods:
+ *   startBoot()
+ *   booting()
+ *   bootTasks()
+ **************************************************/
+
+#define BOOT_SETUP    0
+#define BOOT_STORAGE  1
+#define BOOT_BANNER   2
+#define BOOT_SENSOR   3
+#define BOOT_LCD      4
+#define BOOT_TIMES    5
+#define BOOT_DONE     6
+
+static byte bootStage;
+static unsigned long bootSensorReady;    //millis() when the early conversion is done
+static unsigned long bootTimes[BOOT_DONE]; //millis() at the end of each stage
+
+//from setup(), starts the early conversion
+void startBoot() {
+  bootSensorReady = millis() + startEarlyConversion();
+}
+
+boolean booting() {
+  return bootStage != BOOT_DONE;
+}
+
+//a stage per pass of the loop, until booting() is false
+void bootTasks() {
+  switch (bootStage) {
+  case BOOT_SETUP:
+    //just returned
+    break;
+  case BOOT_STORAGE:
+    initDataLog();
+    initHistory();
+    break;
+  case BOOT_BANNER:
+    printBootBanner();
+    break;
+  case BOOT_SENSOR:
+    if ((long)(millis() - bootSensorReady) < 0) {
+      return;
+    }
+    endEarlyConversion();
+    initTempSensor();
+    //the first run reads the early conversion and starts a full one
+    backgroundTasks();
+    TimerWheel.start(backgroundTimer, TEMP_UPDATE_PERIOD, backgroundTasks, TIMER_PERIODIC);
+    break;
+  case BOOT_LCD:
+    initLcd();
+    loadMainScreen();
+    Global.lastUserInteraction = now();
+    break;
+  case BOOT_TIMES:
+    if (!printBootTimes()) {
+      return;
+    }
+    break;
+  }
+  bootTimes[bootStage] = millis();
+  bootStage++;
+}
+
+//plain text, only before the first telemetry frame
+void printBootBanner() {
+  Serial.println();
+  Serial.print("Wellcome to HotReptile! ");
+  Serial.println(VERSION);
+  Serial.println();
+
+  Settings.debugConfig();
+  Serial.println();
+
+  checkStack();
+  printMemory();
+}
+
+//telemetry is running by now, waits for room in LogSink to go out whole
+boolean printBootTimes() {
+  if (LogSink.room() < 64) {
+    return false;
+  }
+  LogSink.beginRecord();
+  LogSink.print("Boot ms: setup ");
+  LogSink.print(bootTimes[BOOT_SETUP]);
+  LogSink.print(" storage ");
+  LogSink.print(bootTimes[BOOT_STORAGE]);
+  LogSink.print(" sensor ");
+  LogSink.print(bootTimes[BOOT_SENSOR]);
+  LogSink.print(" lcd ");
+  LogSink.println(bootTimes[BOOT_LCD]);
+  LogSink.endRecord();
+  return true;
+}
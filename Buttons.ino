@@ -13,22 +13,29 @@
 //enter ..O..
 
 #define NUM_OF_BUTTONS 5
+#define BUTTONS_REPEAT (1000/BUTTONS_SPEED) //ms between repeats of a held button
+#define BUTTONS_SETTLE 2 //us from selecting a mux channel to reading it
 
 #include "Constants.h"
 
+typedef FastPin<BUTTONS_A_PIN> ButtonsA;
+typedef FastPin<BUTTONS_B_PIN> ButtonsB;
+typedef FastPin<BUTTONS_C_PIN> ButtonsC;
+typedef FastPin<BUTTONS_INPUT_PIN> ButtonsInput;
+
 void initButtons() {
   
-  pinMode(BUTTONS_INPUT_PIN, INPUT);    
-  pinMode(BUTTONS_A_PIN, OUTPUT);
-  pinMode(BUTTONS_B_PIN, OUTPUT);
-  pinMode(BUTTONS_C_PIN, OUTPUT);
+  ButtonsInput::input();
+  ButtonsA::output();
+  ButtonsB::output();
+  ButtonsC::output();
 
 }
 
 void callButton(char buttonNumber, boolean isPressed) {
-  static unsigned char lastPress[NUM_OF_BUTTONS];
+  static uint64_t nextRepeat[NUM_OF_BUTTONS];
   
-  if (buttonFilter(isPressed, &(lastPress[buttonNumber]))) { return; }
+  if (buttonFilter(isPressed, &(nextRepeat[buttonNumber]))) { return; }
   
   switch(buttonNumber) {
   case 0:
@@ -51,10 +58,7 @@ void callButton(char buttonNumber, boolean isPressed) {
 void buttons() {
   boolean isPressed;
   for(char n = 0; n != NUM_OF_BUTTONS; n++) {
-    digitalWrite(BUTTONS_A_PIN, bitRead(n, 0));
-    digitalWrite(BUTTONS_B_PIN, bitRead(n, 1));
-    digitalWrite(BUTTONS_C_PIN, bitRead(n, 2));
-    isPressed = digitalRead(BUTTONS_INPUT_PIN);
+    isPressed = readButton(n);
 
     if (isPressed) {
       Global.lastUserInteraction = now();
@@ -65,17 +69,28 @@ void buttons() {
   
 }
 
-boolean buttonFilter(boolean isPressed, unsigned char *lastPress) {
+//selects button n on the mux and reads it
+boolean readButton(char n) {
+  ButtonsA::set(bitRead(n, 0));
+  ButtonsB::set(bitRead(n, 1));
+  ButtonsC::set(bitRead(n, 2));
+  //the input synchronizer and the mux need time to show the new channel
+  delayMicroseconds(BUTTONS_SETTLE);
+  return ButtonsInput::read();
+}
+
+//a press fires at once, a held button repeats every BUTTONS_REPEAT ms
+boolean buttonFilter(boolean isPressed, uint64_t *nextRepeat) {
   if (!isPressed) {
-    *lastPress = 0;
+    *nextRepeat = 0;
     return true;
   }
   
-  if (*lastPress > 0) {
-    (*lastPress)--;
+  uint64_t time = monoMillis();
+  if (time < *nextRepeat) {
     return true;
   }  
-  *lastPress = 1000/BUTTONS_SPEED/PROGRAM_SPEED;
+  *nextRepeat = time + BUTTONS_REPEAT;
 
   return false;
 }
@@ -0,0 +1,47 @@
+/**************************************************
+ * class: Buzzer
+ * constructor: initBuzzer()
+ *
+ * Beeps without holding up the loop. The pin is toggled from TimerWheel's
+ * 1ms tick, so a tone's half period is whole milliseconds: up to 500Hz,
+ * coarse but plenty for a piezo alarm. tone() can't be used, TimerWheel
+ * owns Timer2.
+ *
+ * methods:
+ *   beep(unsigned int frequency, unsigned int duration)
+ **************************************************/
+
+typedef FastPin<BUZZER_PIN> BuzzerPin;
+
+static Timer buzzerToggle;
+static Timer buzzerStop;
+
+void initBuzzer() {
+  BuzzerPin::output();
+  BuzzerPin::low();
+}
+
+// frequency in Hz, duration in ms. A new beep replaces one still playing,
+// frequency 0 is silence
+void beep(unsigned int frequency, unsigned int duration) {
+  if (frequency == 0) {
+    buzzerOff();
+    TimerWheel.cancel(buzzerStop);
+    return;
+  }
+  unsigned int halfPeriod = (500 + frequency / 2) / frequency;
+  TimerWheel.start(buzzerToggle, halfPeriod, buzzerFlip, TIMER_PERIODIC | TIMER_ISR);
+  TimerWheel.start(buzzerStop, duration, buzzerOff, TIMER_ISR);
+}
+
+void buzzerFlip() {
+  //buzzerOff() may have run first in the same tick
+  if (TimerWheel.active(buzzerToggle)) {
+    BuzzerPin::toggle();
+  }
+}
+
+void buzzerOff() {
+  TimerWheel.cancel(buzzerToggle);
+  BuzzerPin::low();
+}
@@ -0,0 +1,67 @@
+/**************************************************
+ * class: Checkpoint
+ * constructor: initCheckpoint()
+ *
+ * State that changes too often for the EEPROM is kept in the DS1307's
+ * battery backed NVRAM instead, at offset 11: the relay state and the
+ * heater energy counter. The record carries a CRC and the counter is
+ * restored at boot; the relay state is only kept for the record, the
+ * relay starts off after a reset. The EEPROM holds the crash record,
+ * the settings, the profiles and History, see the map in Settings.h. A
+ * DS3231 has no such RAM, there is no checkpoint then.
+ *
+ * methods:
+ *   saveCheckpoint()
+ **************************************************/
+
+#define CHECKPOINT_OFFSET   11 //NVRAM offset, past 0x0E-0x12 that DS3231RTC probes
+#define CHECKPOINT_VERSION  1
+#define CHECKPOINT_PERIOD   10 //s
+
+struct CheckpointStruct {
+  byte version;
+  time_t time;                  //when it was taken
+  unsigned long relayOnSeconds; //heater energy counter
+  byte relayStatus;
+  byte crc;                     //Dallas CRC-8 of the bytes before
+};
+
+CONFIG_CHECK(CHECKPOINT_OFFSET + sizeof(CheckpointStruct) <= DS1307_NVRAM_SIZE);
+
+static time_t lastCheckpoint;
+static CheckpointStruct checkpoint; //written in the background, keep it out of the stack
+
+void initCheckpoint() {
+  CheckpointStruct cp;
+  
+  Serial.print("Checkpoint ");
+  if (!clockHasNVRAM()
+      || RTC.readNVRAM(CHECKPOINT_OFFSET, (uint8_t*)&cp, sizeof(cp)) != sizeof(cp)
+      || cp.version != CHECKPOINT_VERSION
+      || OneWire::crc8((uint8_t*)&cp, sizeof(cp) - 1) != cp.crc) {
+    Serial.println("not found");
+    return;
+  }
+  
+  setRelayOnSeconds(cp.relayOnSeconds);
+  lastCheckpoint = now();
+  
+  Serial.print("restored, relay on ");
+  Serial.print(cp.relayOnSeconds);
+  Serial.println("s");
+}
+
+void saveCheckpoint() {
+  if (!clockHasNVRAM() || now() - lastCheckpoint < CHECKPOINT_PERIOD || RTC.isNVRAMBusy()) {
+    return;
+  }
+  lastCheckpoint = now();
+  
+  checkpoint.version = CHECKPOINT_VERSION;
+  checkpoint.time = lastCheckpoint;
+  checkpoint.relayOnSeconds = getRelayOnSeconds();
+  checkpoint.relayStatus = getRelayStatus();
+  checkpoint.crc = OneWire::crc8((uint8_t*)&checkpoint, sizeof(checkpoint) - 1);
+  
+  RTC.writeNVRAMAsync(CHECKPOINT_OFFSET, (const uint8_t*)&checkpoint, sizeof(checkpoint));
+}
@@ -20,8 +20,6 @@ float getSimulateClimateTemperature() {
   
   float targetTemp = getSimulateClimationCosine(minC, maxC);
   
-  Serial.print(", targetTemp = ");Serial.print(targetTemp);
-  
   return targetTemp;
 }
 
@@ -29,7 +27,7 @@ float getSimulateClimateTemperature() {
 
 float getSimulateClimationCosine(float minC, float maxC) {
    
-  time_t xTime = now() - Settings.getMinTargetTimeHour() * SECS_PER_HOUR;
+  time_t xTime = localNow() - Settings.getMinTargetTimeHour() * SECS_PER_HOUR;
  
   return (maxC - minC)/2 * (1 - cos(2 * PI * xTime / SECS_PER_DAY)) + minC;
 }
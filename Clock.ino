@@ -0,0 +1,127 @@
+/**************************************************
+ * class: Clock
+ * constructor: initClock()
+ *
+ * Keeps the Time library in step with the RTC, a DS3231 if one answers at
+ * boot, otherwise a DS1307. With RTC_SQW_PIN defined the RTC's 1Hz square
+ * wave counts the seconds through a pin change interrupt and the date is
+ * only read from the RTC at boot and when the count is in doubt.
+ * Otherwise millis() counts and the RTC is read every sync interval.
+ * Syncs after boot run in the background.
+ *
+ * The clockDrift setting trims the RTC's rate: through the aging register
+ * of a DS3231, in software for a DS1307, whole seconds at a time.
+ *
+ * methods:
+ *   clockSet(time_t t)
+ *   applyClockDrift()
+ *   clockHasNVRAM()
+ *   getClockTemperature()
+ **************************************************/
+
+#define CLOCK_TEMP_PERIOD 64 //s, the DS3231 converts this often
+
+static boolean clockIsDS3231;
+static float clockTemp = -127;
+static time_t clockTempTime;
+static time_t clockTrimAnchor; //when the DS1307 was last set, its drift counts from there
+
+#ifdef RTC_SQW_PIN
+static volatile uint8_t clockTicks;
+
+ISR(RTC_SQW_VECT) {
+  // SQW/OUT falls when the RTC's seconds register advances
+  if (digitalRead(RTC_SQW_PIN) == LOW) {
+    clockTicks++;
+  }
+}
+#endif
+
+void initClock() {
+  time_t t;
+  
+  clockIsDS3231 = RTC3231.detect();
+  Serial.print("RTC ");
+  Serial.println(clockIsDS3231 ? "DS3231" : "DS1307");
+  
+  //read once at boot so the time is valid right away, later syncs don't wait for the bus
+  t = clockIsDS3231 ? RTC3231.get() : RTC.get();
+  if (t != 0) {
+    setTime(t);
+  }
+  clockTrimAnchor = t;
+  applyClockDrift();
+  setSyncProvider(clockSync);
+  
+#ifdef RTC_SQW_PIN
+  pinMode(RTC_SQW_PIN, INPUT);
+  digitalWrite(RTC_SQW_PIN, HIGH); //pull-up
+  if (clockIsDS3231) {
+    RTC3231.setSquareWave(DS3231_SQW_1HZ);
+  }
+  else {
+    RTC.setSquareWave(DS1307_SQW_1HZ);
+  }
+  
+  *digitalPinToPCMSK(RTC_SQW_PIN) |= _BV(digitalPinToPCMSKbit(RTC_SQW_PIN));
+  PCICR |= _BV(digitalPinToPCICRbit(RTC_SQW_PIN));
+  setTickSource(&clockTicks);
+#endif
+}
+
+void clockSet(time_t t) {
+  if (clockIsDS3231) {
+    RTC3231.set(t);
+  }
+  else {
+    RTC.set(t);
+  }
+  clockTrimAnchor = t;
+}
+
+//sync provider for the Time library, returns 0 until a background read completes
+time_t clockSync() {
+  if (clockIsDS3231) {
+    return RTC3231.getAsync();
+  }
+  
+  time_t t = RTC.getAsync();
+  if (t == 0) {
+    return 0;
+  }
+  if (clockTrimAnchor == 0) {
+    clockTrimAnchor = t; //the boot read failed, count the drift from now
+  }
+  //the DS1307 can't be trimmed: take whole seconds of drift off and write them back
+  long correction = (float)Settings.getClockDrift() * (long)(t - clockTrimAnchor) / 10000000.0;
+  if (correction != 0) {
+    t -= correction;
+    clockSet(t);
+  }
+  return t;
+}
+
+void applyClockDrift() {
+  if (clockIsDS3231) {
+    //one aging step is about 0.1ppm, positive slows the clock
+    RTC3231.setAging(constrain(Settings.getClockDrift(), -128, 127));
+  }
+}
+
+//only the DS1307 has battery backed RAM
+boolean clockHasNVRAM() {
+  return !clockIsDS3231;
+}
+
+//DS3231 die temperature, a free second sensor. -127 without a DS3231 or
+//until the first read. A due read runs in the background, the value before
+//is returned until it is back
+float getClockTemperature() {
+  float t;
+  if (clockIsDS3231 && (clockTemp == -127 || now() - clockTempTime >= CLOCK_TEMP_PERIOD)
+      && RTC3231.getTemperatureAsync(t)) {
+    clockTemp = t;
+    clockTempTime = now();
+  }
+  return clockTemp;
+}
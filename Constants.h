@@ -8,6 +8,32 @@
 #define ZC_INT 0 //pin 2
 #define TRIAC_PIN 3
 
+// DS1307 SQW/OUT as the 1Hz timebase, uncomment to use. The output is open
+// drain, the internal pull-up is enabled. The vector must be the pin change
+// interrupt of the pin's port: PCINT0_vect for 8-13, PCINT1_vect for A0-A5
+//#define RTC_SQW_PIN A2
+//#define RTC_SQW_VECT PCINT1_vect
+
+// Data log EEPROM, a 24LC256 at 0x50 on the RTC's bus. 0 if not fitted
+#define LOG_EEPROM_SIZE 32768U
+
+// Local time. The RTC and the Time library run in UTC, the schedule and the
+// screen in local time. Offsets are minutes east of UTC. Daylight saving is
+// on when TZ_DST_OFFSET is defined; it starts and ends on the given week of
+// the month (1-4, 0 = last), weekday (1 = Sunday) and local hour.
+#define TZ_STD_OFFSET 0
+// Central European Time, in place of the line above:
+//#define TZ_STD_OFFSET        60
+//#define TZ_DST_OFFSET        120
+//#define TZ_DST_START_WEEK    0
+//#define TZ_DST_START_WEEKDAY 1
+//#define TZ_DST_START_MONTH   3
+//#define TZ_DST_START_HOUR    2
+//#define TZ_DST_END_WEEK      0
+//#define TZ_DST_END_WEEKDAY   1
+//#define TZ_DST_END_MONTH     10
+//#define TZ_DST_END_HOUR      3
+
 
 // LCD software params
 #define LCD_LINES            4
@@ -27,6 +53,26 @@
 
 #define BUTTONS_SPEED 10
 
+// Over-temperature interlock, see Safety. Hard limits, no profile can
+// set a target at or above TARGET_TEMP_LIMIT. All in 0.01C
+#define SAFETY_MAX_TEMP      4000 //the heater is cut at or above
+#define SAFETY_HYSTERESIS    200  //under the ceiling to clear an over-temperature trip
+#define TARGET_TEMP_LIMIT    3500 //highest target, room for overshoot under the clearing point
+
+// Watchdog. It is fed once each of these tasks has checked in
+#define WATCHDOG_TASK_LOOP        0x01
+#define WATCHDOG_TASK_BACKGROUND  0x02
+#define WATCHDOG_TASKS            (WATCHDOG_TASK_LOOP | WATCHDOG_TASK_BACKGROUND)
+// the step running, kept across a reset for the crash record
+#define WATCHDOG_MARK_SETUP       1
+#define WATCHDOG_MARK_UI          2
+#define WATCHDOG_MARK_FAST        3
+#define WATCHDOG_MARK_TIMERS      4
+#define WATCHDOG_MARK_CLOCK       5
+#define WATCHDOG_MARK_SENSOR      6
+#define WATCHDOG_MARK_STORAGE     7
+#define WATCHDOG_MARK_TELEMETRY   8
+
 //#define TEMP_UPDATE_PERIOD 789 //ms. the fastest!
 #define TEMP_UPDATE_PERIOD 1000 //ms. Must be >750ms
 
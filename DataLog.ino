@@ -0,0 +1,209 @@
+/**************************************************
+ * class: DataLog
+ * constructor: initDataLog()
+ *
+ * Keeps history without a host: every LOG_PERIOD the temperature's
+ * min/avg/max, the average setpoint and the relay duty go into a 16 byte
+ * record on the external EEPROM. Records are page aligned and written in
+ * a ring. Each carries a sequence number one up from the slot before, so
+ * the write position is where the sequence breaks; a binary search finds
+ * it at boot. A 24LC256 holds 2048 records, a week at 5 minutes.
+ *
+ * The protocol's LOG_DUMP command streams the records oldest first, as
+ * fast as LogSink takes them.
+ *
+ * methods:
+ *   logData(float tempC)
+ *   startLogDump()
+ *   logDump()
+ **************************************************/
+
+#define LOG_PERIOD       300 //s per record
+#define LOG_RECORD_SIZE  16
+#define LOG_SLOTS        (LOG_EEPROM_SIZE / LOG_RECORD_SIZE)
+
+struct LogRecord {
+  unsigned int seq;   //one up from the slot before
+  time_t time;        //start of the period, UTC
+  int tempMin;        //0.01*C
+  int tempAvg;
+  int tempMax;
+  int setpoint;       //average
+  byte relayDuty;     //% of the period
+  byte crc;           //Dallas CRC-8 of the bytes before
+};
+
+static boolean logReady;
+static unsigned int logHead;  //next slot to write
+static unsigned int logSeq;   //and its sequence number
+static boolean logWrapped;    //slots from logHead on hold older records
+static LogRecord logProbe;    //slot read at boot and by the dump
+
+//the period being aggregated
+static time_t logPeriod;
+static int logMin, logMax;
+static long logTempSum, logSetpointSum;
+static unsigned int logTempSamples, logSamples;
+static unsigned long logRelayOnStart;
+
+static LogRecord logRecord;   //waiting for the EEPROM
+static boolean logPending;
+
+//dump
+#define LOG_DUMP_IDLE    0
+#define LOG_DUMP_READ    1
+#define LOG_DUMP_READING 2
+#define LOG_DUMP_SEND    3
+static byte logDumpState;
+static unsigned int logDumpSlot;
+static unsigned int logDumpLeft;
+
+void initDataLog() {
+  if (LOG_EEPROM_SIZE == 0) {
+    return;
+  }
+  
+  Serial.print("Data log ");
+  if (ExtEEPROM.read(0, (uint8_t*)&logProbe, sizeof(logProbe)) != sizeof(logProbe)) {
+    Serial.println("not found");
+    return;
+  }
+  logReady = true;
+  
+  if (readLogSlot(0)) {
+    //slots before the write position continue slot 0's sequence
+    unsigned int seq0 = logProbe.seq;
+    unsigned int lo = 1;
+    unsigned int hi = LOG_SLOTS;
+    while (lo < hi) {
+      unsigned int mid = lo + (hi - lo) / 2;
+      if (readLogSlot(mid) && logProbe.seq == (unsigned int)(seq0 + mid)) {
+        lo = mid + 1;
+      }
+      else {
+        hi = mid;
+      }
+    }
+    logHead = lo % LOG_SLOTS;
+    logSeq = seq0 + lo;
+    logWrapped = lo == LOG_SLOTS || readLogSlot(logHead);
+  }
+  
+  Serial.print(getLogCount());
+  Serial.println(" records");
+}
+
+boolean readLogSlot(unsigned int slot) {
+  return ExtEEPROM.read(slot * LOG_RECORD_SIZE, (uint8_t*)&logProbe, sizeof(logProbe)) == sizeof(logProbe)
+      && OneWire::crc8((uint8_t*)&logProbe, sizeof(logProbe) - 1) == logProbe.crc;
+}
+
+unsigned int getLogCount() {
+  return logWrapped ? LOG_SLOTS : logHead;
+}
+
+// Called once a second with the latest reading
+void logData(float tempC) {
+  if (!logReady || timeStatus() == timeNotSet) {
+    return;
+  }
+  
+  time_t t = now();
+  time_t period = t - t % LOG_PERIOD;
+  if (period != logPeriod) {
+    if (logSamples > 0) {
+      closeLogPeriod();
+    }
+    logPeriod = period;
+    logMin = 32767;
+    logMax = -32768;
+    logTempSum = 0;
+    logSetpointSum = 0;
+    logTempSamples = 0;
+    logSamples = 0;
+    logRelayOnStart = getRelayOnSeconds();
+  }
+  
+  if (tempC != -127) {
+    int temp = tempC * 100;
+    logMin = min(logMin, temp);
+    logMax = max(logMax, temp);
+    logTempSum += temp;
+    logTempSamples++;
+  }
+  logSetpointSum += (int)(getTargetTemp() * 100);
+  logSamples++;
+  
+  if (logPending && ExtEEPROM.writeAsync(logHead * LOG_RECORD_SIZE, (uint8_t*)&logRecord, sizeof(logRecord))) {
+    logPending = false;
+    if (++logHead == LOG_SLOTS) {
+      logHead = 0;
+      logWrapped = true;
+    }
+    logSeq++;
+  }
+}
+
+// Turn the finished period into a record; a record still waiting for the
+// EEPROM is replaced
+void closeLogPeriod() {
+  LogRecord &r = logRecord;
+  r.seq = logSeq;
+  r.time = logPeriod;
+  if (logTempSamples > 0) {
+    r.tempMin = logMin;
+    r.tempAvg = logTempSum / logTempSamples;
+    r.tempMax = logMax;
+  }
+  else {
+    r.tempMin = r.tempAvg = r.tempMax = (int)0x8000; //no reading
+  }
+  r.setpoint = logSetpointSum / logSamples;
+  r.relayDuty = min((getRelayOnSeconds() - logRelayOnStart) * 100 / LOG_PERIOD, 100);
+  r.crc = OneWire::crc8((uint8_t*)&r, sizeof(r) - 1);
+  logPending = true;
+}
+
+// Start streaming the log, returns the number of records that will follow
+unsigned int startLogDump() {
+  if (!logReady) {
+    return 0;
+  }
+  logDumpSlot = logWrapped ? logHead : 0;
+  logDumpLeft = getLogCount();
+  logDumpState = logDumpLeft > 0 ? LOG_DUMP_READ : LOG_DUMP_IDLE;
+  return logDumpLeft;
+}
+
+// Moves the dump along without waiting for the bus or the serial port
+void logDump() {
+  switch (logDumpState) {
+  case LOG_DUMP_READ:
+    if (ExtEEPROM.readAsync(logDumpSlot * LOG_RECORD_SIZE, (uint8_t*)&logProbe, sizeof(logProbe))) {
+      logDumpState = LOG_DUMP_READING;
+    }
+    break;
+  case LOG_DUMP_READING:
+    if (ExtEEPROM.isBusy()) {
+      break;
+    }
+    if (!ExtEEPROM.failed()) {
+      logDumpState = LOG_DUMP_SEND;
+      break;
+    }
+    nextLogDumpSlot(); //unreadable, the host sees the gap in the sequence
+    break;
+  case LOG_DUMP_SEND:
+    if (protoSendLogRecord((byte*)&logProbe, sizeof(logProbe))) {
+      nextLogDumpSlot();
+    }
+    break;
+  }
+}
+
+void nextLogDumpSlot() {
+  if (++logDumpSlot == LOG_SLOTS) {
+    logDumpSlot = 0;
+  }
+  logDumpState = --logDumpLeft > 0 ? LOG_DUMP_READ : LOG_DUMP_IDLE;
+}
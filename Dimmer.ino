@@ -1,17 +1,22 @@
+typedef FastPin<TRIAC_PIN> TriacPin;
+
 static unsigned long lastZc;
 static boolean triacFired;
 
 void initDimmer() {
-  pinMode(TRIAC_PIN, OUTPUT);
-  digitalWrite(TRIAC_PIN, LOW);
+  TriacPin::output();
+  TriacPin::low();
   attachInterrupt(ZC_INT, zc, FALLING);
 }
 
 void dimmerControl(int power) {
+  if (outputsInhibited()) {
+    return;
+  }
   if (triacFired == false && (long)(micros() - lastZc) > power) {
-      digitalWrite(TRIAC_PIN, HIGH);
+      TriacPin::high();
       delayMicroseconds(50);
-      digitalWrite(TRIAC_PIN, LOW);
+      TriacPin::low();
       triacFired = true;
   }
 }
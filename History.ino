@@ -0,0 +1,164 @@
+/**************************************************
+ * class: History
+ * constructor: initHistory()
+ *
+ * About a day of the sensor's readings at minute resolution in 1KB: raw
+ * DS18B20 units (1/16*C) packed in DeltaCodec blocks. The block being
+ * filled is in RAM; full blocks go to a ring in the internal EEPROM after
+ * the profiles, a byte per pass of the loop so the loop never waits for
+ * the EEPROM. Each block decodes on its own, the protocol's HISTORY
+ * command reads them. A failed reading repeats the last value, a jump of
+ * the clock starts a new block.
+ *
+ * A stored block is followed by a CRC-8 of it, written last: a slot torn
+ * by a reset mid write, or left over from another layout, is not read
+ * back. A block that fills while the last one is still being written is
+ * dropped, counted and logged.
+ *
+ * methods:
+ *   historySample(float tempC)
+ *   persistHistory()
+ *   getHistoryBlock(byte age)
+ **************************************************/
+
+#define HISTORY_PERIOD        60  //s between samples
+#define HISTORY_EEPROM_START  256 //after the profiles
+#define HISTORY_BLOCKS        11  //stored, ~115 samples each
+#define HISTORY_SLOT_SIZE     (DELTA_BLOCK_SIZE + 1) //the block and its CRC
+#define HISTORY_EMPTY         0xFFFFFFFFUL //start time of an erased slot
+
+CONFIG_CHECK(PROFILES_START + PROFILE_SLOTS * sizeof(ProfileStruct) <= HISTORY_EEPROM_START);
+CONFIG_CHECK(HISTORY_EEPROM_START + HISTORY_BLOCKS * HISTORY_SLOT_SIZE <= E2END + 1);
+
+static byte historyBlock[DELTA_BLOCK_SIZE];   //being filled
+static DeltaEncoder historyEncoder;
+static boolean historyStarted;
+static time_t historyNext;                    //when the next sample is due
+static int historyLast;
+
+static byte historyPersist[HISTORY_SLOT_SIZE]; //full, on its way to the EEPROM
+static byte historyPersistPos = HISTORY_SLOT_SIZE;
+static byte historySlot;                      //next EEPROM slot
+static unsigned int historyDropped;           //full blocks lost since boot
+
+void initHistory() {
+  //continue after the newest stored block
+  time_t newest = 0;
+  for (byte slot = 0; slot < HISTORY_BLOCKS; slot++) {
+    time_t t = historyBlockTime(slot);
+    if (t != HISTORY_EMPTY && t >= newest && historySlotValid(slot)) {
+      newest = t;
+      historySlot = (slot + 1) % HISTORY_BLOCKS;
+    }
+  }
+}
+
+time_t historyBlockTime(byte slot) {
+  time_t t = 0;
+  for (byte i = 0; i < 4; i++) {
+    t |= (time_t)EEPROM.read(historyAddress(slot) + i) << (8 * i);
+  }
+  return t;
+}
+
+int historyAddress(byte slot) {
+  return HISTORY_EEPROM_START + slot * HISTORY_SLOT_SIZE;
+}
+
+boolean historySlotValid(byte slot) {
+  byte block[DELTA_BLOCK_SIZE];
+  for (byte i = 0; i < DELTA_BLOCK_SIZE; i++) {
+    block[i] = EEPROM.read(historyAddress(slot) + i);
+  }
+  return OneWire::crc8(block, DELTA_BLOCK_SIZE) == EEPROM.read(historyAddress(slot) + DELTA_BLOCK_SIZE);
+}
+
+// Called once a second with the latest reading
+void historySample(float tempC) {
+  if (timeStatus() == timeNotSet) {
+    return;
+  }
+  time_t t = now();
+  if (historyStarted && t < historyNext && historyNext - t <= HISTORY_PERIOD) {
+    return;
+  }
+  
+  if (tempC != -127) {
+    historyLast = round(tempC * 16);
+  }
+  time_t sampleTime = t - t % HISTORY_PERIOD;
+  if (!historyStarted || sampleTime != historyNext || !historyEncoder.add(historyLast)) {
+    if (historyStarted) {
+      closeHistoryBlock();
+    }
+    historyEncoder.begin(historyBlock, sampleTime, historyLast);
+    historyStarted = true;
+  }
+  historyNext = sampleTime + HISTORY_PERIOD;
+}
+
+void closeHistoryBlock() {
+  if (historyPersistPos < HISTORY_SLOT_SIZE) {
+    //the last one is still being written, a byte takes 3.3ms so this is rare
+    historyDropped++;
+    LogSink.beginRecord();
+    LogSink.print("History block dropped, total ");
+    LogSink.println(historyDropped);
+    LogSink.endRecord();
+    return;
+  }
+  memcpy(historyPersist, historyBlock, DELTA_BLOCK_SIZE);
+  historyPersist[DELTA_BLOCK_SIZE] = OneWire::crc8(historyBlock, DELTA_BLOCK_SIZE);
+  historyPersistPos = 0;
+}
+
+// Write the next changed byte of a full block, once the EEPROM is ready.
+// The CRC goes last, the slot doesn't read back until it is complete
+void persistHistory() {
+  if (historyPersistPos >= HISTORY_SLOT_SIZE || !eeprom_is_ready()) {
+    return;
+  }
+  
+  int address = historyAddress(historySlot);
+  for (; historyPersistPos < HISTORY_SLOT_SIZE; historyPersistPos++) {
+    if (EEPROM.read(address + historyPersistPos) != historyPersist[historyPersistPos]) {
+      EEPROM.write(address + historyPersistPos, historyPersist[historyPersistPos]);
+      historyPersistPos++;
+      break;
+    }
+  }
+  if (historyPersistPos == HISTORY_SLOT_SIZE) {
+    historySlot = (historySlot + 1) % HISTORY_BLOCKS;
+  }
+}
+
+// Copy a block to buffer: age 0 is the one being filled, 1 the newest
+// stored and so on. Returns false past the oldest and for a block that
+// fails its CRC
+boolean getHistoryBlock(byte age, byte *buffer) {
+  if (age == 0) {
+    if (!historyStarted) {
+      return false;
+    }
+    memcpy(buffer, historyBlock, DELTA_BLOCK_SIZE);
+    return true;
+  }
+  if (age > HISTORY_BLOCKS) {
+    return false;
+  }
+  
+  //a block still being written is not in the EEPROM yet
+  byte pending = historyPersistPos < HISTORY_SLOT_SIZE;
+  if (age == 1 && pending) {
+    memcpy(buffer, historyPersist, DELTA_BLOCK_SIZE);
+    return true;
+  }
+  byte slot = (historySlot + HISTORY_BLOCKS - age + pending) % HISTORY_BLOCKS;
+  if (historyBlockTime(slot) == HISTORY_EMPTY) {
+    return false;
+  }
+  for (byte i = 0; i < DELTA_BLOCK_SIZE; i++) {
+    buffer[i] = EEPROM.read(historyAddress(slot) + i);
+  }
+  return OneWire::crc8(buffer, DELTA_BLOCK_SIZE) == EEPROM.read(historyAddress(slot) + DELTA_BLOCK_SIZE);
+}
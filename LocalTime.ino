@@ -0,0 +1,111 @@
+/**************************************************
+ * class: LocalTime
+ * constructor: none, the rules are in Constants.h
+ *
+ * Converts the UTC clock to local time for the schedule and the screen.
+ * The offset in effect and the UTC instants where it started and where it
+ * next changes are kept, so a conversion is a range check and an add; the
+ * transition dates are only worked out again when the range is left.
+ * Local calendar fields are kept too and stepped on from the last call,
+ * like the Time library does for UTC, so the screen doesn't break the
+ * time anew every second.
+ *
+ * methods:
+ *   localNow()
+ *   localNowElements(tmElements_t &tm)
+ *   toLocal(time_t utc)
+ *   toUtc(time_t local)
+ **************************************************/
+
+static long tzOffset = TZ_STD_OFFSET * SECS_PER_MIN;
+
+#ifdef TZ_DST_OFFSET
+static time_t tzValidFrom = 1;  //UTC range tzOffset holds for, empty until the first lookup
+static time_t tzValidTo = 0;
+
+// local time of a rule's transition in the given calendar year
+time_t tzRuleTime(int year, byte week, byte weekday, byte month, byte hour) {
+  tmElements_t tm;
+  
+  if (week == 0) {
+    // last week: start from the first of the next month and step back
+    if (++month > 12) {
+      month = 1;
+      year++;
+    }
+  }
+  tm.Year = CalendarYrToTm(year);
+  tm.Month = month;
+  tm.Day = 1;
+  tm.Hour = hour;
+  tm.Minute = 0;
+  tm.Second = 0;
+  time_t t = makeTime(tm);
+  
+  t += ((7 + weekday - dayOfWeek(t)) % 7) * SECS_PER_DAY;
+  if (week == 0) {
+    t -= 7 * SECS_PER_DAY;
+  }
+  else {
+    t += (week - 1) * 7 * SECS_PER_DAY;
+  }
+  return t;
+}
+
+void tzUpdate(time_t utc) {
+  int thisYear = year(utc);
+  time_t changes[6];  //DST start and end, last year to next year
+  byte i;
+  
+  for (i = 0; i < 3; i++) {
+    changes[2*i] = tzRuleTime(thisYear - 1 + i, TZ_DST_START_WEEK, TZ_DST_START_WEEKDAY, TZ_DST_START_MONTH, TZ_DST_START_HOUR)
+      - TZ_STD_OFFSET * SECS_PER_MIN;
+    changes[2*i + 1] = tzRuleTime(thisYear - 1 + i, TZ_DST_END_WEEK, TZ_DST_END_WEEKDAY, TZ_DST_END_MONTH, TZ_DST_END_HOUR)
+      - TZ_DST_OFFSET * SECS_PER_MIN;
+  }
+  
+  // the latest change at or before utc sets the offset, the earliest after it ends the range
+  tzValidFrom = 0;
+  tzValidTo = 0xFFFFFFFFUL;
+  tzOffset = TZ_STD_OFFSET * SECS_PER_MIN;
+  for (i = 0; i < 6; i++) {
+    if (changes[i] <= utc) {
+      if (changes[i] >= tzValidFrom) {
+        tzValidFrom = changes[i];
+        tzOffset = (i & 1 ? TZ_STD_OFFSET : TZ_DST_OFFSET) * SECS_PER_MIN;
+      }
+    }
+    else if (changes[i] < tzValidTo) {
+      tzValidTo = changes[i];
+    }
+  }
+}
+#endif
+
+time_t toLocal(time_t utc) {
+#ifdef TZ_DST_OFFSET
+  if (utc >= tzValidTo || utc < tzValidFrom) {
+    tzUpdate(utc);
+  }
+#endif
+  return utc + tzOffset;
+}
+
+time_t localNow() {
+  return toLocal(now());
+}
+
+static tmElements_t localElements;
+static time_t localElementsTime; //local time localElements hold, 0 for none
+
+void localNowElements(tmElements_t &tm) {
+  stepElements(localNow(), localElements, localElementsTime);
+  tm = localElements;
+}
+
+// A local time in the hour skipped by the spring change is taken as
+// daylight time, one repeated in autumn as standard time.
+time_t toUtc(time_t local) {
+  time_t utc = local - TZ_STD_OFFSET * SECS_PER_MIN;
+  return local - (toLocal(utc) - utc);
+}
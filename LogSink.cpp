@@ -0,0 +1,72 @@
+#include "LogSink.h"
+
+LogSinkClass LogSink;
+
+void LogSinkClass::begin(unsigned long baud) {
+  Serial.begin(baud);
+#if ARDUINO < 10606
+  _bytesPerSec = baud / 10; //8N1
+  _lastPump = micros();
+  _budget = LOG_TX_BUFFER * 1000U;
+#endif
+}
+
+/*
+  Move queued bytes to Serial without blocking. Newer cores tell how much
+  room the TX buffer has, older ones block on a full buffer, so there the
+  bytes are metered at the line rate instead.
+*/
+void LogSinkClass::pump() {
+#if ARDUINO >= 10606
+  int room = Serial.availableForWrite();
+#else
+  unsigned long t = micros();
+  unsigned long elapsed = min(t - _lastPump, 100000UL); //the buffer has long drained by then
+  _lastPump = t;
+  _budget = min(_budget + elapsed * _bytesPerSec / 1000, LOG_TX_BUFFER * 1000UL); //bytes x1000
+  int room = _budget / 1000;
+#endif
+  
+  for (int sent = 0; sent < room && _tail != _head; sent++) {
+    Serial.write(_buffer[_tail]);
+    if (++_tail == LOG_BUFFER_SIZE) {
+      _tail = 0;
+    }
+#if ARDUINO < 10606
+    _budget -= 1000;
+#endif
+  }
+}
+
+void LogSinkClass::beginRecord() {
+  _write = _head;
+  _full = false;
+}
+
+/*
+  Publish the record written since beginRecord(). Returns false if it
+  didn't fit and was dropped.
+*/
+boolean LogSinkClass::endRecord() {
+  if (_full) {
+    _dropped++;
+    _write = _head;
+    return false;
+  }
+  _head = _write;
+  return true;
+}
+
+size_t LogSinkClass::write(uint8_t b) {
+  byte next = _write + 1;
+  if (next == LOG_BUFFER_SIZE) {
+    next = 0;
+  }
+  if (_full || next == _tail) {
+    _full = true;
+    return 0;
+  }
+  _buffer[_write] = b;
+  _write = next;
+  return 1;
+}
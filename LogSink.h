@@ -0,0 +1,56 @@
+#ifndef LOGSINK_h
+#define LOGSINK_h
+
+#include <Arduino.h>
+
+// Bytes queued for Serial. Whole records must fit, see LogSinkClass
+#define LOG_BUFFER_SIZE 160
+
+// Hardware TX buffer of cores without Serial.availableForWrite()
+#define LOG_TX_BUFFER 64
+
+/*
+  Non blocking Serial output. Records are queued in a ring buffer and
+  pumped to Serial only as fast as the UART takes them, so a host that
+  doesn't read never stalls the loop. A record that doesn't fit is
+  dropped whole and counted; the count is for the next record to report.
+  
+    LogSink.beginRecord();
+    LogSink.print(...);
+    if (LogSink.endRecord()) ...
+*/
+class LogSinkClass : public Print {
+public:
+  void begin(unsigned long baud);
+  void pump();
+  
+  void beginRecord();
+  boolean endRecord();
+  
+  //bytes a record may take now without being dropped
+  byte room() { return (_tail + LOG_BUFFER_SIZE - _head - 1) % LOG_BUFFER_SIZE; }
+  
+  unsigned int getDropped() { return _dropped; }
+  void clearDropped(unsigned int count) { _dropped -= count; }
+  
+  virtual size_t write(uint8_t b);
+  using Print::write;
+  
+private:
+  byte _buffer[LOG_BUFFER_SIZE];
+  byte _tail;      //next byte for Serial
+  byte _head;      //end of the committed records
+  byte _write;     //end of the record being written
+  boolean _full;   //the record being written didn't fit
+  unsigned int _dropped;
+  
+#if ARDUINO < 10606
+  unsigned long _bytesPerSec;
+  unsigned long _lastPump; //us
+  unsigned int _budget;    //bytes the UART has room for, x1000
+#endif
+};
+
+extern LogSinkClass LogSink;
+
+#endif
@@ -0,0 +1,106 @@
+/**************************************************
+ * class: Memory
+ * constructor: none, the stack is painted before main()
+ *
+ * RAM use at run time. Before the C runtime starts, everything between the
+ * end of the static data and the top of RAM is filled with STACK_CANARY.
+ * Whatever the stack has been down to since is no longer painted, so the
+ * painted bytes left above the heap are the smallest free gap there has
+ * been. checkStack() rescans it every background tick and reports on the
+ * log once it gets under STACK_MARGIN, well before the stack runs into the
+ * heap and corrupts it without a trace.
+ *
+ * The static RAM here is only the totals, tools/memory_report.py breaks
+ * .data and .bss down per module from the build.
+ *
+ * methods:
+ *   checkStack()
+ *   getStackFree()
+ *   getStackLowWater()
+ *   printMemory()
+ **************************************************/
+
+#define STACK_CANARY 0xC5
+#define STACK_MARGIN 64  //bytes, less free stack than this gets reported
+
+// from the linker script and malloc
+extern uint8_t __data_start, __data_end, __bss_start, __heap_start;
+extern char *__brkval;
+
+static unsigned int stackLowWater = 0xFFFF;
+static boolean stackLowReported;
+
+void paintStack() __attribute__ ((naked, used, section(".init3")));
+
+// .init3 runs with the stack pointer set and before .data and .bss are
+// filled in, which don't reach past __heap_start anyway
+void paintStack() {
+  uint8_t *p = &__heap_start;
+  while (p < (uint8_t*)SP) {
+    *p++ = STACK_CANARY;
+  }
+}
+
+uint8_t *heapEnd() {
+  return __brkval ? (uint8_t*)__brkval : &__heap_start;
+}
+
+// bytes between the heap and the stack right now
+unsigned int getStackFree() {
+  return (uint8_t*)SP - heapEnd();
+}
+
+// bytes between the heap and the deepest the stack has been
+unsigned int getStackLowWater() {
+  return stackLowWater;
+}
+
+//every background tick, a scan of the free gap takes well under a ms
+void checkStack() {
+  uint8_t *start = heapEnd();
+  uint8_t *end = (uint8_t*)SP;
+  uint8_t *p = start;
+
+  while (p < end && *p == STACK_CANARY) {
+    p++;
+  }
+  if ((unsigned int)(p - start) < stackLowWater) {
+    stackLowWater = p - start;
+  }
+
+  if (stackLowWater < STACK_MARGIN && !stackLowReported) {
+    stackLowReported = true;
+    LogSink.beginRecord();
+    LogSink.print("Stack low, free bytes: ");
+    LogSink.println(stackLowWater);
+    LogSink.endRecord();
+  }
+}
+
+//static RAM from the linker, noinit counted with bss
+void printMemory() {
+  Serial.print("RAM data: ");
+  Serial.print(&__data_end - &__data_start);
+  Serial.print(" bss: ");
+  Serial.print(&__heap_start - &__bss_start);
+  Serial.print(" heap: ");
+  Serial.print(heapEnd() - &__heap_start);
+  Serial.print(" stack free: ");
+  Serial.print(getStackFree());
+  Serial.print(" lowest: ");
+  Serial.println(stackLowWater);
+}
+
+//for PROTO_MEMORY: data bss heap free lowest, 2 bytes each
+void getMemoryStatus(byte *out) {
+  unsigned int v[5];
+  v[0] = &__data_end - &__data_start;
+  v[1] = &__heap_start - &__bss_start;
+  v[2] = heapEnd() - &__heap_start;
+  v[3] = getStackFree();
+  v[4] = stackLowWater;
+  for (byte i = 0; i < 5; i++) {
+    out[i * 2] = lowByte(v[i]);
+    out[i * 2 + 1] = highByte(v[i]);
+  }
+}
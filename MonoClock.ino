@@ -0,0 +1,48 @@
+/**************************************************
+ * class: MonoClock
+ * constructor: none, syncMonoTime() keeps it anchored
+ *
+ * A 64 bit millisecond clock for event stamps and timeouts. It never
+ * wraps and never steps back, so intervals are a plain subtraction and
+ * stamps keep their order across RTC syncs and clock changes.
+ * monoMillis() counts from boot, extending millis() past its 49 day wrap;
+ * it has to be read at least once per wrap, the background tasks do.
+ * monoTime() is milliseconds since 1970: the boot count plus an anchor that
+ * syncMonoTime() takes from the clock. When the clock is set back the stamps
+ * hold still until it has caught up.
+ *
+ * methods:
+ *   monoMillis()
+ *   monoTime()
+ *   syncMonoTime()
+ **************************************************/
+
+static unsigned long monoHigh;  //millis() wraps so far
+static unsigned long monoLow;   //last millis() read
+static uint64_t monoAnchor;     //ms since 1970 at boot
+static uint64_t monoLast;       //last stamp given out
+
+uint64_t monoMillis() {
+  unsigned long ms = millis();
+  if (ms < monoLow) {
+    monoHigh++;
+  }
+  monoLow = ms;
+  return ((uint64_t)monoHigh << 32) | ms;
+}
+
+uint64_t monoTime() {
+  uint64_t t = monoAnchor + monoMillis();
+  if (t < monoLast) {
+    return monoLast;
+  }
+  monoLast = t;
+  return t;
+}
+
+void syncMonoTime() {
+  if (timeStatus() == timeNotSet) {
+    return;
+  }
+  monoAnchor = (uint64_t)now() * 1000 + millisecond() - monoMillis();
+}
@@ -85,9 +85,12 @@ void enterPressedMenuImpl(boolean isPressed) {
     loadTempSetupScreen();
     break;
   case 1:
-    loadTimeSetupScreen();
+    loadProfileScreen();
     break;
   case 2:
+    loadTimeSetupScreen();
+    break;
+  case 3:
     loadAboutScreen();
     break;
   }
@@ -193,7 +196,6 @@ void rightPressedTempSetupImpl(boolean isPressed) {
 void enterPressedTempSetupImpl(boolean isPressed) {
   if (selSec == EDIT_ITEMS) {
     Settings.saveConfig();
-    Settings.debugConfig();
     loadMenuScreen();
     return;
   }
@@ -313,8 +315,9 @@ void rightPressedTimeSetupImpl(boolean isPressed) {
 }
 void enterPressedTimeSetupImpl(boolean isPressed) {
   if (timeChanged) {
-    setTime(editTime);
-    RTC.set(editTime);
+    time_t t = toUtc(editTime);
+    setTime(t);
+    clockSet(t);
   }
   loadMenuScreen();
 }
@@ -332,7 +335,7 @@ void loadTimeSetupScreen() {
   
   selection = 0;
   
-  editTime = now();
+  editTime = localNow();
   
   logic = &timeSetupScreenLogic;
   
@@ -353,6 +356,57 @@ void loadTimeSetupScreen() {
 
 
 
+void upPressedProfileImpl(boolean isPressed) {
+  if (selection > 0) {
+    selection--;
+  }
+}
+void downPressedProfileImpl(boolean isPressed) {
+  if (selection < PROFILE_SLOTS - 1) {
+    selection++;
+  }
+}
+void leftPressedProfileImpl(boolean isPressed) {
+  loadMenuScreen();
+}
+void enterPressedProfileImpl(boolean isPressed) {
+  //takes effect on the next control cycle
+  Settings.selectProfile(selection);
+  loadMenuScreen();
+}
+
+void profileScreenLogic() {
+  drawCur(0, selection);
+}
+
+void loadProfileScreen() {
+  upPressed = &upPressedProfileImpl;
+  downPressed = &downPressedProfileImpl;
+  leftPressed = &leftPressedProfileImpl;
+  rightPressed = &enterPressedProfileImpl;
+  enterPressed = &enterPressedProfileImpl;
+  
+  selection = Settings.getActiveProfile();
+  
+  logic = &profileScreenLogic;
+  
+  clearScreen();
+  
+  printProfileList();
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
 void exitPressedAboutImpl(boolean isPressed) {
   loadMenuScreen();
 }
@@ -0,0 +1,227 @@
+/**************************************************
+ * class: Protocol
+ * constructor: none, call serialProtocol() from loop
+ *
+ * Binary settings access and host time sync over Serial. Multi-byte
+ * values are little endian. Frames both ways:
+ *   SYNC LEN CMD PAYLOAD[LEN-1] CRC
+ * LEN counts CMD and PAYLOAD, CRC is the Dallas CRC-8 of LEN..PAYLOAD.
+ * A reply carries CMD | PROTO_REPLY and starts with a status byte.
+ *
+ * methods:
+ *   serialProtocol()
+ **************************************************/
+
+#define PROTO_SYNC          0xA5
+#define PROTO_REPLY         0x80
+#define PROTO_MAX_LEN       48
+#define PROTO_BYTE_TIMEOUT  100 //ms, a gap this long drops a partial frame
+
+// commands
+#define PROTO_GET_FIELD     0x01 // id                 -> status id lo hi
+#define PROTO_SET_FIELD     0x02 // id lo hi           -> status
+#define PROTO_DUMP          0x03 //                    -> status block
+#define PROTO_RESTORE       0x04 // block              -> status
+#define PROTO_COMMIT        0x05 //                    -> status
+#define PROTO_STATUS        0x06 //                    -> status version fields profile saving
+#define PROTO_TIME_SYNC     0x07 // time[4] ms[2]      -> status offset[4] drift[2]
+#define PROTO_LOG_DUMP      0x08 //                    -> status count[2], then count LOG_RECORD frames
+#define PROTO_LOG_RECORD    0x09 // unsolicited            status record[16], see DataLog
+#define PROTO_HISTORY       0x0A // age half           -> status data[32], half a History block
+#define PROTO_MEMORY        0x0B //                    -> status data[2] bss[2] heap[2] free[2] lowest[2], see Memory
+#define PROTO_PROFILE_NAME  0x0C // name[1..9]         -> status, renames the active profile
+
+// status
+#define PROTO_OK            0x00
+#define PROTO_BAD_FIELD     0x01
+#define PROTO_BAD_VALUE     0x02
+#define PROTO_BAD_LENGTH    0x03
+#define PROTO_BAD_COMMAND   0x04
+#define PROTO_BAD_BLOCK     0x05
+#define PROTO_NO_LOG        0x06
+
+static byte protoFrame[PROTO_MAX_LEN + 2]; // LEN CMD PAYLOAD CRC
+static byte protoPos;
+static unsigned long protoLastByte;
+
+void serialProtocol() {
+  while (Serial.available() > 0) {
+    byte b = Serial.read();
+    
+    if (protoPos > 0 && millis() - protoLastByte > PROTO_BYTE_TIMEOUT) {
+      protoPos = 0;
+    }
+    protoLastByte = millis();
+    
+    if (protoPos == 0) { //waiting for sync
+      if (b == PROTO_SYNC) {
+        protoPos = 1;
+      }
+      continue;
+    }
+    
+    if (protoPos == 1 && (b == 0 || b > PROTO_MAX_LEN)) { //bad length, resync
+      protoPos = 0;
+      continue;
+    }
+    
+    protoFrame[protoPos - 1] = b;
+    protoPos++;
+    
+    // frame is complete after LEN + LEN bytes + CRC
+    if (protoPos - 1 == protoFrame[0] + 2) {
+      byte len = protoFrame[0];
+      if (OneWire::crc8(protoFrame, len + 1) == protoFrame[len + 1]) {
+        protoCommand(protoFrame[1], protoFrame + 2, len - 1);
+      }
+      protoPos = 0;
+    }
+  }
+}
+
+void protoCommand(byte cmd, byte *payload, byte len) {
+  byte reply[PROTO_MAX_LEN];
+  byte replyLen = 1;
+  int value;
+  
+  reply[0] = PROTO_OK;
+  
+  switch (cmd) {
+  case PROTO_GET_FIELD:
+    if (len != 1) {
+      reply[0] = PROTO_BAD_LENGTH;
+    }
+    else if (Settings.getField(payload[0], value) != FIELD_OK) {
+      reply[0] = PROTO_BAD_FIELD;
+    }
+    else {
+      reply[1] = payload[0];
+      reply[2] = lowByte(value);
+      reply[3] = highByte(value);
+      replyLen = 4;
+    }
+    break;
+  case PROTO_SET_FIELD:
+    if (len != 3) {
+      reply[0] = PROTO_BAD_LENGTH;
+      break;
+    }
+    switch (Settings.setField(payload[0], (int)word(payload[2], payload[1]))) {
+    case FIELD_UNKNOWN:
+      reply[0] = PROTO_BAD_FIELD;
+      break;
+    case FIELD_OUT_OF_RANGE:
+      reply[0] = PROTO_BAD_VALUE;
+      break;
+    }
+    break;
+  case PROTO_DUMP:
+    memcpy(reply + 1, Settings.getBlock(), Settings.getBlockSize());
+    replyLen += Settings.getBlockSize();
+    break;
+  case PROTO_RESTORE:
+    if (!Settings.restoreBlock(payload, len)) {
+      reply[0] = PROTO_BAD_BLOCK;
+    }
+    break;
+  case PROTO_COMMIT:
+    Settings.commitConfig();
+    break;
+  case PROTO_STATUS:
+    reply[1] = CONFIG_SCHEMA_VERSION;
+    reply[2] = Settings.getFieldCount();
+    reply[3] = Settings.getActiveProfile();
+    reply[4] = Settings.isSaving() || Settings.isProfilePending();
+    replyLen = 5;
+    break;
+  case PROTO_TIME_SYNC: {
+    if (len != 6) {
+      reply[0] = PROTO_BAD_LENGTH;
+      break;
+    }
+    int ms = word(payload[5], payload[4]);
+    if (ms < 0 || ms > 999) {
+      reply[0] = PROTO_BAD_VALUE;
+      break;
+    }
+    long offset = timeSync(((time_t)word(payload[3], payload[2]) << 16) | word(payload[1], payload[0]), ms);
+    int drift = Settings.getClockDrift();
+    reply[1] = offset;
+    reply[2] = offset >> 8;
+    reply[3] = offset >> 16;
+    reply[4] = offset >> 24;
+    reply[5] = lowByte(drift);
+    reply[6] = highByte(drift);
+    replyLen = 7;
+    break;
+  }
+  case PROTO_LOG_DUMP: {
+    unsigned int count = startLogDump();
+    if (count == 0 && !logReady) {
+      reply[0] = PROTO_NO_LOG;
+      break;
+    }
+    reply[1] = lowByte(count);
+    reply[2] = highByte(count);
+    replyLen = 3;
+    break;
+  }
+  case PROTO_HISTORY: {
+    byte block[DELTA_BLOCK_SIZE];
+    if (len != 2) {
+      reply[0] = PROTO_BAD_LENGTH;
+    }
+    else if (payload[1] > 1 || !getHistoryBlock(payload[0], block)) {
+      reply[0] = PROTO_BAD_VALUE;
+    }
+    else {
+      memcpy(reply + 1, block + payload[1] * (DELTA_BLOCK_SIZE / 2), DELTA_BLOCK_SIZE / 2);
+      replyLen += DELTA_BLOCK_SIZE / 2;
+    }
+    break;
+  }
+  case PROTO_MEMORY:
+    getMemoryStatus(reply + 1);
+    replyLen += 10;
+    break;
+  case PROTO_PROFILE_NAME:
+    if (!Settings.setProfileName((const char*)payload, len)) {
+      reply[0] = PROTO_BAD_VALUE;
+    }
+    break;
+  default:
+    reply[0] = PROTO_BAD_COMMAND;
+    break;
+  }
+  
+  protoReply(cmd | PROTO_REPLY, reply, replyLen);
+}
+
+// Queue a LOG_RECORD frame if LogSink has room for it, the dump waits otherwise
+boolean protoSendLogRecord(byte *record, byte len) {
+  byte payload[PROTO_MAX_LEN];
+  
+  if (LogSink.room() < len + 6) { // SYNC LEN CMD status record CRC 0x00
+    return false;
+  }
+  payload[0] = PROTO_OK;
+  memcpy(payload + 1, record, len);
+  protoReply(PROTO_LOG_RECORD | PROTO_REPLY, payload, len + 1);
+  return true;
+}
+
+void protoReply(byte cmd, byte *payload, byte len) {
+  byte frame[PROTO_MAX_LEN + 2];
+  
+  frame[0] = len + 1;
+  frame[1] = cmd;
+  memcpy(frame + 2, payload, len);
+  frame[len + 2] = OneWire::crc8(frame, len + 2);
+  
+  //queued behind the telemetry; if the host doesn't drain it the reply is lost, the host retries
+  LogSink.beginRecord();
+  LogSink.write(PROTO_SYNC);
+  LogSink.write(frame, len + 3);
+  LogSink.write((byte)0); //ends the frame for a telemetry reader, skipped while waiting for sync
+  LogSink.endRecord();
+}
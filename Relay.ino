@@ -2,43 +2,55 @@
  * class: Relay
  * constructor: initRelay()
  *
+ * Temperature control is not wired in: setup() doesn't call initRelay()
+ * and backgroundTasks() doesn't call controlRelay(), as from the start.
+ * The relay only moves through relay() from the interlock and the sensor
+ * checks, which turn it off, and a profile's temperatures and PID gains
+ * don't reach the output yet.
+ *
  * methods:
  *   setTargetTemp(float temp)
  *   controlRelay(float currentTemp)
+ *   getRelayOnSeconds()
  **************************************************/
 #include <PID_v1.h>
 
 #define RELAY_ON HIGH
 #define RELAY_OFF LOW
 
+typedef FastPin<RELAY_PIN> RelayPin;
+
 double Input, Output;
 double targetTemp = 14;
 double adjustmentTemp = - 0.8;
 
 PID myPID(&Input, &Output, &targetTemp, 2, 0.25, 1, DIRECT);
 
-unsigned long timeRelayChanged = 0;
+uint64_t timeRelayChanged = 0;
 
 float tempDeviation = 0.5;
 static byte relayStatus;
+static boolean relayDecided; //the first decision after boot skips the lockout
+
+//heater energy counter, kept across resets by the checkpoint
+static unsigned long relayOnSeconds;
+static unsigned int relayOnMillis; //part of a second not counted yet
+static uint64_t relayOnSince;
 
 void initRelay() {
-  pinMode(RELAY_PIN, OUTPUT);
-  digitalWrite(RELAY_PIN, LOW);
+  RelayPin::output();
+  RelayPin::low();
   relayStatus = RELAY_OFF;
   
   myPID.SetMode(AUTOMATIC);
   myPID.SetOutputLimits(0,1);
+  myPID.SetTunings(Settings.getPidKp(), Settings.getPidKi(), Settings.getPidKd());
 }
 
 void controlTimedRelay(float thresholdOn) {
   
   float currentPercent = getSimulateClimationCosine(0, 1);
   
-  
-  Serial.print(", currentPercent = ");
-  Serial.print(currentPercent);
-  
   if (currentPercent >= thresholdOn) {
     relay(RELAY_ON);
   }
@@ -68,17 +80,14 @@ void setTargetTemp(float temp) {
 }
 
 void controlRelay(float currentTemp) {
+  //once it is called: gains follow the active profile, the PID below is bypassed
+  myPID.SetTunings(Settings.getPidKp(), Settings.getPidKi(), Settings.getPidKd());
   _controlRelay(currentTemp);
-  Serial.print(", relayStatus = ");
-  Serial.print(relayStatus, DEC);
   
   return;
   
   Input = currentTemp;
   myPID.Compute();
-  
-  Serial.print(", pid = ");
-  Serial.print(Output*100);
 
   if (Output > 0.5) {
     relay(RELAY_ON);
@@ -91,16 +100,11 @@ void controlRelay(float currentTemp) {
 void _controlRelay(float currentTemp) {
   float differenceTemp = currentTemp - targetTemp - adjustmentTemp;
 
-  unsigned long time = millis();
-  //avoid time overflow issues
-  if (time < timeRelayChanged) {
-    timeRelayChanged = 0;
-  }
-  
   //avoid fast relay on/off. delay states switches for 2s
-  if (time - timeRelayChanged < 2000) {
+  if (relayDecided && monoMillis() - timeRelayChanged < 2000) {
     return;
   }
+  relayDecided = true;
   
   
 
@@ -123,8 +127,43 @@ void relay(byte on) {
   if (on != RELAY_ON && on != RELAY_OFF) { //wrong value
     return;
   }
-    
+  
+  countRelayOnTime();
+  
+  //the Safety interlock cuts the pin from the tick, don't let a write race it
+  uint8_t oldSREG = SREG;
+  cli();
+  if (on == RELAY_ON && outputsInhibited()) { //no valid reading or tripped, see Watchdog
+    on = RELAY_OFF;
+  }
   relayStatus = on;
-  digitalWrite(RELAY_PIN, relayStatus);
-  timeRelayChanged = millis();
+  RelayPin::set(relayStatus);
+  SREG = oldSREG;
+
+  timeRelayChanged = monoMillis();
+  relayOnSince = timeRelayChanged;
+}
+
+byte getRelayStatus() {
+  return relayStatus;
+}
+
+void countRelayOnTime() {
+  if (relayStatus == RELAY_ON) {
+    uint64_t ms = monoMillis();
+    unsigned long on = (unsigned long)(ms - relayOnSince) + relayOnMillis;
+    relayOnSeconds += on / 1000;
+    relayOnMillis = on % 1000;
+    relayOnSince = ms;
+  }
+}
+
+unsigned long getRelayOnSeconds() {
+  countRelayOnTime();
+  return relayOnSeconds;
+}
+
+void setRelayOnSeconds(unsigned long seconds) {
+  relayOnSeconds = seconds;
+  relayOnMillis = 0;
 }
@@ -0,0 +1,79 @@
+/**************************************************
+ * class: Safety
+ * constructor: initSafety()
+ *
+ * Over-temperature interlock that doesn't wait for the loop. A TIMER_ISR
+ * timer checks every SAFETY_PERIOD ms, inside TimerWheel's tick, that the
+ * last valid reading is under SAFETY_MAX_TEMP and younger than
+ * SAFETY_MAX_AGE. If not, it drives the relay and triac pins low right
+ * there and trips: the outputs stay inhibited until a fresh reading is
+ * SAFETY_HYSTERESIS under the ceiling again. A slow melody, the LCD or a
+ * stuck bus delay the control loop, not this. The tick can't call relay(),
+ * safetyResync() does from the loop so the relay state follows the pin.
+ *
+ * The limits are constants on purpose, a hard stop that no setting or
+ * profile can raise; SAFETY_MAX_TEMP and SAFETY_HYSTERESIS are in
+ * Constants.h next to the cap on the profile targets.
+ *
+ * methods:
+ *   safetyReading(float temp)
+ *   safetyResync()
+ *   safetyTripped()
+ **************************************************/
+
+#define SAFETY_PERIOD      10    //ms between checks
+#define SAFETY_MAX_AGE     5000  //ms without a valid reading before the heater is cut
+
+static Timer safetyTimer;
+static volatile int safetyTemp;            //last valid reading, 0.01C
+static volatile unsigned int safetyAge;    //ms since then
+static volatile boolean safetyTrip;
+static volatile boolean safetyCut;         //the tick cut the pins, relay() doesn't know yet
+
+void initSafety() {
+  safetyAge = 0;
+  safetyTrip = true; //until the first reading
+  TimerWheel.start(safetyTimer, SAFETY_PERIOD, safetyCheck, TIMER_PERIODIC | TIMER_ISR);
+}
+
+// in the tick, keep it short
+void safetyCheck() {
+  if (safetyAge < SAFETY_MAX_AGE) {
+    safetyAge += SAFETY_PERIOD;
+  }
+  if (safetyAge >= SAFETY_MAX_AGE || safetyTemp >= SAFETY_MAX_TEMP) {
+    RelayPin::low();
+    TriacPin::low();
+    if (!safetyTrip) {
+      safetyTrip = true;
+      safetyCut = true;
+    }
+  }
+}
+
+// every loop pass, and before a reading can clear the trip
+void safetyResync() {
+  if (safetyCut) {
+    safetyCut = false;
+    relay(RELAY_OFF);
+  }
+}
+
+// a valid reading, from validateSensor()
+void safetyReading(float temp) {
+  int t = temp * 100;
+  
+  safetyResync();
+
+  noInterrupts();
+  safetyTemp = t;
+  safetyAge = 0;
+  if (t < SAFETY_MAX_TEMP - SAFETY_HYSTERESIS) {
+    safetyTrip = false;
+  }
+  interrupts();
+}
+
+boolean safetyTripped() {
+  return safetyTrip;
+}
@@ -1,6 +1,6 @@
 
 // include the library code:
-#include <ShiftRegLCD.h>
+#include <FastShiftRegLCD.h>
 
 #include "Settings.h"
 
@@ -23,7 +23,7 @@
  **************************************************/
 
 
-ShiftRegLCD lcd(LCD_DATA_PIN, LCD_CLOCK_PIN, LCD_ENABLE_PIN, LCD_LINES);
+FastShiftRegLCD<LCD_DATA_PIN, LCD_CLOCK_PIN, LCD_ENABLE_PIN> lcd(LCD_LINES);
 
 
 
@@ -40,6 +40,7 @@ void toggleScr() {
 }
 
 void initLcd() {
+  lcd.begin();
   pinMode(LCD_BRIGHTNESS_PIN, OUTPUT);
   
   turnOnLcdBrightness();
@@ -73,7 +74,9 @@ void turnOnLcdBrightness() {
 
 void autocontrolLcdBrightness() {
   if (Global.lastUserInteraction + Settings.getLcdTimeout() < now()) {
-    int hourNow = hour();
+    tmElements_t tm;
+    localNowElements(tm);
+    int hourNow = tm.Hour;
     int lcdMinBrightness = 0;
     if (hourNow > 5 && hourNow < 24) {
       lcdMinBrightness = LCD_MIN_BRIGHTNESS;
@@ -101,9 +104,10 @@ void loadMenu(byte menuNumber) {
  switch (menuNumber) {
   case MAIN_MENU:
     buffer[0] = "Set temperatures   ";
-    buffer[1] = "Time and date      ";
-    buffer[2] = "About              ";
-    bufferLen = 3;
+    buffer[1] = "Profiles           ";
+    buffer[2] = "Time and date      ";
+    buffer[3] = "About              ";
+    bufferLen = 4;
    break; 
   case 99:
     buffer[0] = "menu0              ";
@@ -349,7 +353,22 @@ void printChar() {
   lcd.print("  ");
 }
 
+void printProfileList() {
+  char name[PROFILE_NAME_SIZE];
+  for (byte i = 0; i < PROFILE_SLOTS && i < LCD_LINES; i++) {
+    Settings.getProfileName(i, name);
+    printString(1, i, name);
+    if (i == Settings.getActiveProfile()) {
+      printString(LCD_LINE_SIZE - 1, i, "*");
+    }
+  }
+}
+
 void printAboutScreen() {
+  lcd.setCursor(0, 0);
+  lcd.print("Free RAM: ");
+  lcd.print(getStackLowWater());
+  lcd.print("  ");
   lcd.setCursor(8, 1);
   lcd.print("Hot");
   lcd.setCursor(6, 2);
@@ -361,50 +380,11 @@ void printAboutScreen() {
 void printButton() {
   lcd.setCursor(15, 0);
   
-  digitalWrite(BUTTONS_A_PIN,0);
-  digitalWrite(BUTTONS_B_PIN,0);
-  digitalWrite(BUTTONS_C_PIN,0);
-  int v = digitalRead(BUTTONS_INPUT_PIN);  
-  if (v == HIGH) {
-    lcd.print("O");
-  } else {lcd.print(".");}
-//  Serial.print(v); Serial.print(" ");
-  
-  digitalWrite(BUTTONS_A_PIN,1);
-  digitalWrite(BUTTONS_B_PIN,0);
-  digitalWrite(BUTTONS_C_PIN,0);
-  v = digitalRead(BUTTONS_INPUT_PIN);
-  if (v == HIGH) {
-    lcd.print("O");
-  } else {lcd.print(".");}
-//  Serial.print(v); Serial.print(" ");
-  
-  digitalWrite(BUTTONS_A_PIN,0);
-  digitalWrite(BUTTONS_B_PIN,1);
-  digitalWrite(BUTTONS_C_PIN,0);
-  v = digitalRead(BUTTONS_INPUT_PIN); 
-  if (v == HIGH) {
-    lcd.print("O");
-  } else {lcd.print(".");}
-//  Serial.print(v); Serial.print(" ");
-  
-  digitalWrite(BUTTONS_A_PIN,1);
-  digitalWrite(BUTTONS_B_PIN,1);
-  digitalWrite(BUTTONS_C_PIN,0);
-  v = digitalRead(BUTTONS_INPUT_PIN); 
-  if (v == HIGH) {
-    lcd.print("O");
-  } else {lcd.print(".");}
-//  Serial.print(v); Serial.print(" "); 
-  
-  digitalWrite(BUTTONS_A_PIN,0);
-  digitalWrite(BUTTONS_B_PIN,0);
-  digitalWrite(BUTTONS_C_PIN,1);
-  v = digitalRead(BUTTONS_INPUT_PIN); 
-  if (v == HIGH) {
-    lcd.print("O");
-  } else {lcd.print(".");}
-  //Serial.println(v);
+  for (char n = 0; n != NUM_OF_BUTTONS; n++) {
+    if (readButton(n)) {
+      lcd.print("O");
+    } else {lcd.print(".");}
+  }
 }
 
 void printTargetTemp(byte lineNumber) {
@@ -421,7 +401,9 @@ void printDigits(int digits){
 }
 
 void printDateTime(byte lineNumber) {
-  printDateTime(lineNumber, now());
+  tmElements_t tm;
+  localNowElements(tm);
+  printDateTime(lineNumber, tm.Hour, tm.Minute, tm.Second, tm.Day, tm.Month, tmYearToCalendar(tm.Year));
 }
 
 void printDateTime(byte lineNumber, time_t time) {
@@ -491,19 +473,20 @@ void printTimeSetupScreen() {
   // set the cursor to column 0, line 1
   // (note: line 1 is the second row, since counting begins with 0):
   lcd.setCursor(0, 1);
+  time_t t = localNow();
   // print the number of seconds since reset:
-  printDigits(hour());
+  printDigits(hour(t));
   lcd.print(":");
-  printDigits(minute());
+  printDigits(minute(t));
   lcd.print(":");
-  printDigits(second());
+  printDigits(second(t));
   
   lcd.setCursor(10, 1);
-  printDigits(day());//read date
+  printDigits(day(t));//read date
   lcd.print("/");
-  printDigits(month());//read month
+  printDigits(month(t));//read month
   lcd.print("/");
-  printDigits(year()); //read year
+  printDigits(year(t)); //read year
 }
 
 
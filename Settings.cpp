@@ -1,65 +1,424 @@
+#include <avr/eeprom.h>
+
 #include "Settings.h"
+#include "LogSink.h"
+
+#define SETTINGS_FIELD(name, type, def, lo, hi) \
+  { offsetof(SettingsStoreStruct, name), type, def, lo, hi }
+
+// Schema of the current version. Values out of range are reset to default
+static const SettingsField settingsFields[] PROGMEM = {
+  SETTINGS_FIELD(lcdTimeout, FIELD_BYTE, 30, 0, 255),
+  SETTINGS_FIELD(activeProfile, FIELD_BYTE, 0, 0, PROFILE_SLOTS - 1),
+  SETTINGS_FIELD(profile.lcdBrightness, FIELD_BYTE, 120, LCD_MIN_BRIGHTNESS, 255),
+  SETTINGS_FIELD(profile.maxTargetTemp, FIELD_INT, 2260, 0, TARGET_TEMP_LIMIT), //22.6*C
+  SETTINGS_FIELD(profile.minTargetTemp, FIELD_INT, 1530, 0, TARGET_TEMP_LIMIT), //15.3*C
+  SETTINGS_FIELD(profile.midTempRatio, FIELD_BYTE, 35, 0, 100), //35%
+  SETTINGS_FIELD(profile.midTempHoursDuration, FIELD_BYTE, 10, MIN_MID_TEMP_HOURS_DURATION, MAX_MID_TEMP_HOURS_DURATION),
+  SETTINGS_FIELD(profile.maxTargetTimeHours, FIELD_BYTE, 13, 0, HOURS_PER_DAY - 1), //encoding 13:00
+  SETTINGS_FIELD(profile.relayOnDayPercent, FIELD_BYTE, 50, 0, 100),
+  SETTINGS_FIELD(profile.pidKp, FIELD_INT, 200, 0, 10000), //2.0
+  SETTINGS_FIELD(profile.pidKi, FIELD_INT, 25, 0, 10000), //0.25
+  SETTINGS_FIELD(profile.pidKd, FIELD_INT, 100, 0, 10000), //1.0
+  SETTINGS_FIELD(clockDrift, FIELD_INT, 0, -CLOCK_DRIFT_LIMIT, CLOCK_DRIFT_LIMIT), //0.1ppm
+  SETTINGS_FIELD(telemetryMode, FIELD_BYTE, TELEMETRY_BINARY, TELEMETRY_OFF, TELEMETRY_TEXT),
+  SETTINGS_FIELD(telemetryPeriod, FIELD_BYTE, 1, 1, 255), //s
+};
+
+#define SETTINGS_FIELDS (sizeof(settingsFields) / sizeof(SettingsField))
+
+// Stored layout of schema version 2, a single set of values
+struct SettingsStoreV2 {
+  char version[4];
+  byte lcdBrightness; 
+  byte lcdTimeout;
+  int maxTargetTemp;
+  int minTargetTemp;
+  byte midTempRatio;
+  byte midTempHoursDuration;
+  byte maxTargetTimeHours;
+  byte relayOnDayPercent;
+};
+
+CONFIG_CHECK(sizeof(SettingsStoreV2) == CONFIG_SIZE_V2);
 
 void SettingsClass::loadConfig() {
   // To make sure there are settings, and they are YOURS!
   // If nothing is found it will use the default settings.
-  if (EEPROM.read(CONFIG_START + 0) == CONFIG_VERSION[0] &&
-      EEPROM.read(CONFIG_START + 1) == CONFIG_VERSION[1] &&
-      EEPROM.read(CONFIG_START + 2) == CONFIG_VERSION[2]) {
-    Serial.println("Loading settings...");
-    for (unsigned int t=0; t<sizeof(_vars); t++) {
-      *((byte*)&_vars + t) = EEPROM.read(CONFIG_START + t);
-    }
-    
-    debugConfig();
-  }
-  else {
+  byte version = storedVersion();
+  if (version == 0 || version > CONFIG_SCHEMA_VERSION) {
     Serial.println("ERROR GETING SETTINGS FROM EEPROM.\nLoading defaults.");
     loadDefault();
     saveConfig();
+    return;
+  }
+  
+  Serial.println("Loading settings...");
+  for (unsigned int t=0; t<sizeof(_vars); t++) {
+    *((byte*)&_vars + t) = EEPROM.read(CONFIG_START + t);
+  }
+  
+  boolean changed = false;
+  if (version < CONFIG_SCHEMA_VERSION) {
+    Serial.print("Migrating settings from version ");
+    Serial.println(version, DEC);
+    if (!migrateConfig(version)) {
+      Serial.println("No migration path.\nLoading defaults.");
+      loadDefault();
+    }
+    changed = true;
+  }
+  
+  _vars.version[0] = CONFIG_MAGIC[0];
+  _vars.version[1] = CONFIG_MAGIC[1];
+  _vars.version[2] = '0' + CONFIG_SCHEMA_VERSION;
+  _vars.version[3] = 0;
+  
+  if (validateConfig() > 0 || changed) {
+    saveConfig();
+  }
+}
+
+/*
+  Returns the schema version of the block in EEPROM or 0 if there is none
+*/
+byte SettingsClass::storedVersion() {
+  if (EEPROM.read(CONFIG_START + 0) != CONFIG_MAGIC[0] ||
+      EEPROM.read(CONFIG_START + 1) != CONFIG_MAGIC[1]) {
+    return 0;
+  }
+  
+  byte version = EEPROM.read(CONFIG_START + 2) - '0';
+  return version <= 9 ? version : 0;
+}
+
+/*
+  Bring a block read from an older schema up to date, one version at a
+  time. Each step converts _vars in place, it may re-read EEPROM for fields
+  that moved. New fields can be left alone, validateConfig() defaults them.
+*/
+boolean SettingsClass::migrateConfig(byte version) {
+  for (; version < CONFIG_SCHEMA_VERSION; version++) {
+    switch (version) {
+    case 2: {
+      //v3: the values became profile 0, gains and name are new
+      SettingsStoreV2 v2;
+      for (unsigned int t=0; t<sizeof(v2); t++) {
+        *((byte*)&v2 + t) = EEPROM.read(CONFIG_START + t);
+      }
+      loadDefault();
+      _vars.lcdTimeout = v2.lcdTimeout;
+      _vars.profile.lcdBrightness = v2.lcdBrightness;
+      _vars.profile.maxTargetTemp = v2.maxTargetTemp;
+      _vars.profile.minTargetTemp = v2.minTargetTemp;
+      _vars.profile.midTempRatio = v2.midTempRatio;
+      _vars.profile.midTempHoursDuration = v2.midTempHoursDuration;
+      _vars.profile.maxTargetTimeHours = v2.maxTargetTimeHours;
+      _vars.profile.relayOnDayPercent = v2.relayOnDayPercent;
+      break;
+    }
+    case 3:
+      //v4: clock drift appended, the bytes read past the v3 block are not ours
+      _vars.clockDrift = 0;
+      break;
+    case 4:
+      //v5: telemetry mode and rate appended
+      _vars.telemetryMode = TELEMETRY_BINARY;
+      _vars.telemetryPeriod = 1;
+      break;
+    default:
+      return false;
+    }
+  }
+  
+  return true;
+}
+
+/*
+  Reset every field out of its valid range to its default.
+  Returns the number of fields reset.
+*/
+byte SettingsClass::validateConfig() {
+  byte resets = 0;
+  SettingsField field;
+  
+  for (byte i = 0; i < SETTINGS_FIELDS; i++) {
+    memcpy_P(&field, &settingsFields[i], sizeof(field));
+    int value = readField(field);
+    if (value < field.minValue || value > field.maxValue) {
+      //also runs on a profile switch, with telemetry on the port
+      LogSink.beginRecord();
+      LogSink.print("\tfield ");LogSink.print(i, DEC);LogSink.println(" out of range, using default");
+      LogSink.endRecord();
+      writeField(field, field.defaultValue);
+      resets++;
+    }
+  }
+  
+  //a slot never written has no name
+  char *name = _vars.profile.name;
+  name[PROFILE_NAME_SIZE - 1] = 0;
+  if (name[0] < ' ' || name[0] > '~') {
+    defaultProfileName(_vars.activeProfile, name);
+    resets++;
+  }
+  
+  return resets;
+}
+
+int SettingsClass::readField(const SettingsField &field) {
+  byte *p = (byte*)&_vars + field.offset;
+  if (field.type == FIELD_INT) {
+    return *((int*)p);
+  }
+  return *p;
+}
+
+void SettingsClass::writeField(const SettingsField &field, int value) {
+  byte *p = (byte*)&_vars + field.offset;
+  if (field.type == FIELD_INT) {
+    *((int*)p) = value;
+  }
+  else {
+    *p = value;
   }
 }
 
 void SettingsClass::debugConfig() {
   Serial.print("\tversion = ");Serial.println(_vars.version);
-  Serial.print("\tlcdBrightness = ");Serial.println(_vars.lcdBrightness, DEC);
   Serial.print("\tlcdTimeout = ");Serial.println(_vars.lcdTimeout, DEC);
-  Serial.print("\tmidTempRatio = ");Serial.println(_vars.midTempRatio, DEC);
-  Serial.print("\tmidTempHoursDuration = ");Serial.println(_vars.midTempHoursDuration, DEC);
-  Serial.print("\tmaxTargetTemp = ");Serial.println(_vars.maxTargetTemp, DEC);
-  Serial.print("\tminTargetTemp = ");Serial.println(_vars.minTargetTemp, DEC);
-  Serial.print("\tmaxTargetTimeHours = ");Serial.println(_vars.maxTargetTimeHours, DEC);
-  Serial.print("\trelayOnDayPercent = ");Serial.println(_vars.relayOnDayPercent, DEC);
+  Serial.print("\tactiveProfile = ");Serial.println(_vars.activeProfile, DEC);
+  Serial.print("\tname = ");Serial.println(_vars.profile.name);
+  Serial.print("\tlcdBrightness = ");Serial.println(_vars.profile.lcdBrightness, DEC);
+  Serial.print("\tmidTempRatio = ");Serial.println(_vars.profile.midTempRatio, DEC);
+  Serial.print("\tmidTempHoursDuration = ");Serial.println(_vars.profile.midTempHoursDuration, DEC);
+  Serial.print("\tmaxTargetTemp = ");Serial.println(_vars.profile.maxTargetTemp, DEC);
+  Serial.print("\tminTargetTemp = ");Serial.println(_vars.profile.minTargetTemp, DEC);
+  Serial.print("\tmaxTargetTimeHours = ");Serial.println(_vars.profile.maxTargetTimeHours, DEC);
+  Serial.print("\trelayOnDayPercent = ");Serial.println(_vars.profile.relayOnDayPercent, DEC);
+  Serial.print("\tpid = ");Serial.print(_vars.profile.pidKp, DEC);
+  Serial.print(", ");Serial.print(_vars.profile.pidKi, DEC);
+  Serial.print(", ");Serial.println(_vars.profile.pidKd, DEC);
+  Serial.print("\tclockDrift = ");Serial.println(_vars.clockDrift, DEC);
+  Serial.print("\ttelemetry = ");Serial.print(_vars.telemetryMode, DEC);
+  Serial.print(", every ");Serial.print(_vars.telemetryPeriod, DEC);Serial.println("s");
   
 }
 
 
+/*
+  Schedule a save. The settings are written by persistConfig() once no
+  other change happened for CONFIG_SAVE_DELAY, so a burst of edits
+  costs a single write-back.
+*/
 void SettingsClass::saveConfig() {
-  Serial.println("Saving settings...");
-  for (unsigned int t=0; t<sizeof(_vars); t++) {
-    EEPROM.write(CONFIG_START + t, *((byte*)&_vars + t));
+  _dirty = true;
+  _lastChange = millis();
+  _persistPos = 0; //start over, already written bytes are skipped anyway
+}
+
+/*
+  Call on every loop pass. Writes at most one changed byte per call and
+  never waits for the EEPROM, a byte write takes ~3.3ms to complete.
+*/
+void SettingsClass::persistConfig() {
+  if (!_dirty) {
+    //switch only after the old profile made it to its slot
+    if (_profileRequest != 0) {
+      loadProfile(_profileRequest - 1);
+      _profileRequest = 0;
+    }
+    return;
+  }
+  
+  //a waiting profile switch doesn't wait for the quiet period
+  if (_profileRequest == 0 && (millis() - _lastChange) < CONFIG_SAVE_DELAY) {
+    return;
+  }
+  
+  //previous byte is still being programmed, try on the next pass
+  if (!eeprom_is_ready()) {
+    return;
+  }
+  
+  //the block at CONFIG_START, followed by the active profile's slot
+  for (; _persistPos < sizeof(_vars) + sizeof(ProfileStruct); _persistPos++) {
+    byte value;
+    int address;
+    if (_persistPos < sizeof(_vars)) {
+      value = *((byte*)&_vars + _persistPos);
+      address = CONFIG_START + _persistPos;
+    }
+    else {
+      value = *((byte*)&_vars.profile + _persistPos - sizeof(_vars));
+      address = profileAddress(_vars.activeProfile) + _persistPos - sizeof(_vars);
+    }
+    
+    if (EEPROM.read(address) != value) {
+      EEPROM.write(address, value);
+      _persistPos++;
+      return;
+    }
   }
+  
+  _dirty = false;
+  _persistPos = 0;
+}
+
+/*
+  Request a switch to another profile slot. The switch happens in
+  persistConfig() between two loop passes, so the control code sees either
+  the old or the new profile, never a mix.
+*/
+void SettingsClass::selectProfile(byte slot) {
+  if (slot >= PROFILE_SLOTS) {
+    return;
+  }
+  _profileRequest = slot + 1;
+}
+
+void SettingsClass::loadProfile(byte slot) {
+  int address = profileAddress(slot);
+  for (unsigned int t=0; t<sizeof(ProfileStruct); t++) {
+    *((byte*)&_vars.profile + t) = EEPROM.read(address + t);
+  }
+  _vars.activeProfile = slot;
+  
+  validateConfig();
+  saveConfig();
+}
+
+/*
+  Copy the name of a profile slot in name, at least PROFILE_NAME_SIZE long
+*/
+void SettingsClass::getProfileName(byte slot, char *name) {
+  if (slot == _vars.activeProfile) {
+    strcpy(name, _vars.profile.name);
+    return;
+  }
+  
+  int address = profileAddress(slot) + offsetof(ProfileStruct, name);
+  for (byte i = 0; i < PROFILE_NAME_SIZE; i++) {
+    name[i] = EEPROM.read(address + i);
+  }
+  name[PROFILE_NAME_SIZE - 1] = 0;
+  if (name[0] < ' ' || name[0] > '~') {
+    defaultProfileName(slot, name);
+  }
+}
+
+/*
+  Rename the active profile, len printable characters, no terminator.
+  Saved like any other change
+*/
+boolean SettingsClass::setProfileName(const char *name, byte len) {
+  if (len == 0 || len >= PROFILE_NAME_SIZE) {
+    return false;
+  }
+  for (byte i = 0; i < len; i++) {
+    if (name[i] < ' ' || name[i] > '~') {
+      return false;
+    }
+  }
+  memcpy(_vars.profile.name, name, len);
+  _vars.profile.name[len] = 0;
+  saveConfig();
+  return true;
+}
+
+void SettingsClass::defaultProfileName(byte slot, char *name) {
+  strcpy(name, "Profile ");
+  name[8] = '1' + slot;
+  name[9] = 0;
+}
+
+/*
+  Write any pending change right away. Blocks while the bytes get written.
+*/
+void SettingsClass::flushConfig() {
+  commitConfig();
+  while (_dirty) {
+    persistConfig();
+  }
+}
+
+/*
+  Save without waiting for the quiet period, still in the background.
+*/
+void SettingsClass::commitConfig() {
+  saveConfig();
+  _lastChange = millis() - CONFIG_SAVE_DELAY;
+}
+
+byte SettingsClass::getFieldCount() {
+  return SETTINGS_FIELDS;
+}
+
+byte SettingsClass::getField(byte id, int &value) {
+  if (id >= SETTINGS_FIELDS) {
+    return FIELD_UNKNOWN;
+  }
+  
+  SettingsField field;
+  memcpy_P(&field, &settingsFields[id], sizeof(field));
+  value = readField(field);
+  return FIELD_OK;
+}
+
+/*
+  Range checked write of a field. The change is kept in RAM until the
+  settings are saved. Writing activeProfile switches profile.
+*/
+byte SettingsClass::setField(byte id, int value) {
+  if (id >= SETTINGS_FIELDS) {
+    return FIELD_UNKNOWN;
+  }
+  
+  SettingsField field;
+  memcpy_P(&field, &settingsFields[id], sizeof(field));
+  if (value < field.minValue || value > field.maxValue) {
+    return FIELD_OUT_OF_RANGE;
+  }
+  
+  if (field.offset == offsetof(SettingsStoreStruct, activeProfile)) {
+    selectProfile(value);
+  }
+  else {
+    writeField(field, value);
+  }
+  return FIELD_OK;
+}
+
+/*
+  Replace the whole block with one of the same schema version, i.e. a
+  previous dump. Fields out of range fall back to their defaults.
+*/
+boolean SettingsClass::restoreBlock(const byte *block, byte size) {
+  if (size != sizeof(_vars) ||
+      block[0] != CONFIG_MAGIC[0] || block[1] != CONFIG_MAGIC[1] ||
+      block[2] != '0' + CONFIG_SCHEMA_VERSION) {
+    return false;
+  }
+  
+  memcpy(&_vars, block, sizeof(_vars));
+  _profileRequest = 0;
+  validateConfig();
+  return true;
 }
 
 
 void SettingsClass::loadDefault() {
-  _vars.version[0] = CONFIG_VERSION[0];
-  _vars.version[1] = CONFIG_VERSION[1];
-  _vars.version[2] = CONFIG_VERSION[2];
-  _vars.version[3] = CONFIG_VERSION[3];
-  // The default values
-  _vars.lcdBrightness = 120;
-  _vars.lcdTimeout = 30;
-  _vars.midTempRatio = 35; //35%
-  _vars.midTempHoursDuration = 10; //hours
-  _vars.maxTargetTemp = 2260; //22.6*C
-  _vars.minTargetTemp = 1530; //15.3*C
-  _vars.maxTargetTimeHours = 13; //encoding 13:00
-  
-  _vars.relayOnDayPercent = 50;
-//  _vars.maxTargetTimeMinutes = 40;
-//  _vars.minTargetTimeHours = 4; //encoding 4:25
-//  _vars.minTargetTimeMinutes = 25;
+  _vars.version[0] = CONFIG_MAGIC[0];
+  _vars.version[1] = CONFIG_MAGIC[1];
+  _vars.version[2] = '0' + CONFIG_SCHEMA_VERSION;
+  _vars.version[3] = 0;
+  // The default values come from the schema
+  SettingsField field;
+  for (byte i = 0; i < SETTINGS_FIELDS; i++) {
+    memcpy_P(&field, &settingsFields[i], sizeof(field));
+    writeField(field, field.defaultValue);
+  }
+  defaultProfileName(_vars.activeProfile, _vars.profile.name);
 }
 
 SettingsClass Settings;
@@ -1,6 +1,7 @@
 #ifndef SETTINGS_h
 #define SETTINGS_h
 
+#include <stddef.h>
 #include <Arduino.h>
 #include <EEPROM.h>
 #include <Time.h>
@@ -11,20 +12,45 @@
 #define MIN_MID_TEMP_HOURS_DURATION 4
 #define MAX_MID_TEMP_HOURS_DURATION 16
 
+#define CLOCK_DRIFT_LIMIT 5000 //0.1ppm, 500ppm is far beyond any working crystal
 
-// ID of the settings block
-#define CONFIG_VERSION "Rt2"
+// What the background task sends over Serial
+#define TELEMETRY_OFF    0
+#define TELEMETRY_BINARY 1 //COBS framed records, see Telemetry.ino
+#define TELEMETRY_TEXT   2 //one readable line per record
+
+
+// ID of the settings block: two magic chars followed by the schema version
+// digit, i.e. "Rt2". Bump the version on any change of SettingsStoreStruct
+// and add a step to SettingsClass::migrateConfig()
+#define CONFIG_MAGIC "Rt"
+#define CONFIG_SCHEMA_VERSION 5
+
+// EEPROM map:
+//   0    crash record, WATCHDOG_EEPROM_START in Watchdog
+//   32   settings block, CONFIG_START
+//   128  profile slots, PROFILES_START
+//   256  History blocks up to the end, HISTORY_EEPROM_START in History
+// What changes too often for the EEPROM is in the DS1307's NVRAM, see
+// Checkpoint
 
 // Tell it where to store your config data in EEPROM
 #define CONFIG_START 32
 
+// Quiet period after the last change before the settings are written back
+#define CONFIG_SAVE_DELAY 3000 //ms
 
+// Profile slots live after the settings block, leaving it room to grow
+#define PROFILES_START 128
+#define PROFILE_SLOTS 4
+#define PROFILE_NAME_SIZE 10
 
-struct SettingsStoreStruct {
-  char version[4];
-  // The settings variables
+
+
+// A named set of climate values, one per species/enclosure
+struct ProfileStruct {
+  char name[PROFILE_NAME_SIZE];
   byte lcdBrightness; 
-  byte lcdTimeout;
 
   int maxTargetTemp;
   int minTargetTemp;
@@ -36,28 +62,116 @@ struct SettingsStoreStruct {
 //  byte maxTargetTimeMinutes;
 //  byte minTargetTimeHours;
 //  byte minTargetTimeMinutes;
+
+  //PID gains x100
+  int pidKp;
+  int pidKi;
+  int pidKd;
+};
+
+struct SettingsStoreStruct {
+  char version[4];
+  // The settings variables
+  byte lcdTimeout;
+  byte activeProfile;
+  
+  // working copy of the active profile slot
+  ProfileStruct profile;
+  
+  int clockDrift; //RTC rate correction learned from host syncs, 0.1ppm
+  
+  byte telemetryMode;
+  byte telemetryPeriod; //s between records
 };
 
+// stored size of each schema version
+#define CONFIG_SIZE_V2 14
+#define CONFIG_SIZE_V3 31
+#define CONFIG_SIZE_V4 33
+#define CONFIG_SIZE_V5 35
+#define PROFILE_SIZE_V3 25
+
+// compile time check of the stored layout. If one fails the struct has
+// changed: bump CONFIG_SCHEMA_VERSION and write a migration step
+#define CONFIG_CHECK_CAT(a, b) a##b
+#define CONFIG_CHECK_NAME(line) CONFIG_CHECK_CAT(config_layout_check_, line)
+#define CONFIG_CHECK(cond) typedef char CONFIG_CHECK_NAME(__LINE__)[(cond) ? 1 : -1]
+
+CONFIG_CHECK(sizeof(SettingsStoreStruct) == CONFIG_SIZE_V5);
+CONFIG_CHECK(sizeof(ProfileStruct) == PROFILE_SIZE_V3);
+CONFIG_CHECK(offsetof(SettingsStoreStruct, activeProfile) == 5);
+CONFIG_CHECK(offsetof(SettingsStoreStruct, profile) == 6);
+CONFIG_CHECK(offsetof(ProfileStruct, maxTargetTemp) == 11);
+// a target the Safety interlock would fight
+CONFIG_CHECK(TARGET_TEMP_LIMIT < SAFETY_MAX_TEMP - SAFETY_HYSTERESIS);
+CONFIG_CHECK(offsetof(ProfileStruct, pidKp) == 19);
+CONFIG_CHECK(offsetof(SettingsStoreStruct, clockDrift) == CONFIG_SIZE_V3);
+CONFIG_CHECK(offsetof(SettingsStoreStruct, telemetryMode) == CONFIG_SIZE_V4);
+CONFIG_CHECK(CONFIG_START + sizeof(SettingsStoreStruct) <= PROFILES_START);
+
+
+// Schema of a stored field: where it lives, its default and valid range
+#define FIELD_BYTE 0
+#define FIELD_INT  1
+
+struct SettingsField {
+  byte offset;
+  byte type;
+  int defaultValue;
+  int minValue;
+  int maxValue;
+};
+
+// Result of the schema driven accessors
+#define FIELD_OK           0
+#define FIELD_UNKNOWN      1
+#define FIELD_OUT_OF_RANGE 2
+
 class SettingsClass {
 public:
   void loadConfig();
   void saveConfig();
+  void persistConfig();
+  void flushConfig();
   void debugConfig(); 
   void loadDefault();
+  byte validateConfig();
+  
+  void commitConfig();
+  
+  boolean isSaving() { return _dirty; }
+  
+  //Schema driven access, id is the field's index in the schema
+  byte getFieldCount();
+  byte getField(byte id, int &value);
+  byte setField(byte id, int value);
+  
+  //Raw settings block, as stored at CONFIG_START
+  const byte* getBlock() { return (const byte*)&_vars; }
+  byte getBlockSize() { return sizeof(_vars); }
+  boolean restoreBlock(const byte *block, byte size);
+  
+  //Profiles
+  byte getActiveProfile() { return _vars.activeProfile; }
+  const char* getProfileName() { return _vars.profile.name; }
+  void getProfileName(byte slot, char *name);
+  boolean setProfileName(const char *name, byte len);
+  void selectProfile(byte slot);
+  boolean isProfilePending() { return _profileRequest != 0; }
 
   //Getters and setters
-  byte getLcdBrightness() { return _vars.lcdBrightness; }
-  void setLcdBrightness(byte lcdBrightness) { _vars.lcdBrightness = lcdBrightness;}
+  byte getLcdBrightness() { return _vars.profile.lcdBrightness; }
+  void setLcdBrightness(byte lcdBrightness) { _vars.profile.lcdBrightness = lcdBrightness;}
   
   byte getLcdTimeout() { return _vars.lcdTimeout; }
   void setLcdTimeout(byte lcdTimeout) { _vars.lcdTimeout = lcdTimeout;}
   
-  float getRelayOnDayPercent() { return (float)(_vars.relayOnDayPercent) / 100; }
-  void setRelayOnDayPercent(float relayOnDayPercent) { _vars.relayOnDayPercent = relayOnDayPercent * 100; }
+  float getRelayOnDayPercent() { return (float)(_vars.profile.relayOnDayPercent) / 100; }
+  void setRelayOnDayPercent(float relayOnDayPercent) { _vars.profile.relayOnDayPercent = relayOnDayPercent * 100; }
   
-  float getMidTempRatioFloat() { return (float)(_vars.midTempRatio) / 100; }
-  byte getMidTempRatio() { return _vars.midTempRatio; }
-  void setMidTempRatio(byte midTempRatio) { _vars.midTempRatio = midTempRatio; }
+  float getMidTempRatioFloat() { return (float)(_vars.profile.midTempRatio) / 100; }
+  byte getMidTempRatio() { return _vars.profile.midTempRatio; }
+  void setMidTempRatio(byte midTempRatio) { _vars.profile.midTempRatio = midTempRatio; }
   
   //depricated
   float getMidLowTargetTemp() {
@@ -72,40 +186,50 @@ public:
     return getMinTargetTempFloat() + getMidLowTargetTemp();
   }
   
-  float getMaxTargetTempFloat() { return (float)(_vars.maxTargetTemp) / 100; }
-  int getMaxTargetTemp() { return _vars.maxTargetTemp; }
-  void setMaxTargetTemp(int maxTargetTemp) { _vars.maxTargetTemp = maxTargetTemp;}
+  float getMaxTargetTempFloat() { return (float)(_vars.profile.maxTargetTemp) / 100; }
+  int getMaxTargetTemp() { return _vars.profile.maxTargetTemp; }
+  void setMaxTargetTemp(int maxTargetTemp) { _vars.profile.maxTargetTemp = constrain(maxTargetTemp, 0, TARGET_TEMP_LIMIT);}
   
-  float getMinTargetTempFloat() { return (float)(_vars.minTargetTemp) / 100; }
-  int getMinTargetTemp() { return _vars.minTargetTemp; }
-  void setMinTargetTemp(int minTargetTemp) { _vars.minTargetTemp = minTargetTemp;}
+  float getMinTargetTempFloat() { return (float)(_vars.profile.minTargetTemp) / 100; }
+  int getMinTargetTemp() { return _vars.profile.minTargetTemp; }
+  void setMinTargetTemp(int minTargetTemp) { _vars.profile.minTargetTemp = constrain(minTargetTemp, 0, TARGET_TEMP_LIMIT);}
+
+  float getPidKp() { return (float)(_vars.profile.pidKp) / 100; }
+  float getPidKi() { return (float)(_vars.profile.pidKi) / 100; }
+  float getPidKd() { return (float)(_vars.profile.pidKd) / 100; }
 
-  time_t getMaxTargetTempSeconds() { return _vars.maxTargetTimeHours * SECS_PER_HOUR; }
+  int getClockDrift() { return _vars.clockDrift; }
+  void setClockDrift(int clockDrift) { _vars.clockDrift = constrain(clockDrift, -CLOCK_DRIFT_LIMIT, CLOCK_DRIFT_LIMIT); }
+
+  byte getTelemetryMode() { return _vars.telemetryMode; }
+  byte getTelemetryPeriod() { return _vars.telemetryPeriod; }
+
+  time_t getMaxTargetTempSeconds() { return _vars.profile.maxTargetTimeHours * SECS_PER_HOUR; }
   time_t getMinTargetTempSeconds() { (getMaxTargetTempSeconds() + SECS_PER_HALF_DAY) % SECS_PER_DAY; }  
                            
-  time_t getMidTempSecondsDuration() { return _vars.midTempHoursDuration * SECS_PER_HOUR; }                   
-  char getMidTempHoursDuration() { return _vars.midTempHoursDuration; }
+  time_t getMidTempSecondsDuration() { return _vars.profile.midTempHoursDuration * SECS_PER_HOUR; }                   
+  char getMidTempHoursDuration() { return _vars.profile.midTempHoursDuration; }
   void setMidTempHoursDuration(char midTempHoursDuration) {
     if (midTempHoursDuration < MIN_MID_TEMP_HOURS_DURATION) {
-      _vars.midTempHoursDuration = MAX_MID_TEMP_HOURS_DURATION;
+      _vars.profile.midTempHoursDuration = MAX_MID_TEMP_HOURS_DURATION;
     }
     else if (midTempHoursDuration > MAX_MID_TEMP_HOURS_DURATION) {
-      _vars.midTempHoursDuration = MIN_MID_TEMP_HOURS_DURATION;
+      _vars.profile.midTempHoursDuration = MIN_MID_TEMP_HOURS_DURATION;
     }
     else {
-      _vars.midTempHoursDuration = midTempHoursDuration;
+      _vars.profile.midTempHoursDuration = midTempHoursDuration;
     }
   }
   
-  char getMinTargetTimeHour() { return (_vars.maxTargetTimeHours + HOURS_PER_HALF_DAY) % HOURS_PER_DAY; }
-  char getMaxTargetTimeHour() { return _vars.maxTargetTimeHours; }
+  char getMinTargetTimeHour() { return (_vars.profile.maxTargetTimeHours + HOURS_PER_HALF_DAY) % HOURS_PER_DAY; }
+  char getMaxTargetTimeHour() { return _vars.profile.maxTargetTimeHours; }
   void setMaxTargetTimeHour(char maxTargetTimeHours) {
     if (maxTargetTimeHours < 0)
-      _vars.maxTargetTimeHours = HOURS_PER_DAY - 1;
+      _vars.profile.maxTargetTimeHours = HOURS_PER_DAY - 1;
     else if (maxTargetTimeHours > HOURS_PER_DAY - 1)
-      _vars.maxTargetTimeHours = 0;
+      _vars.profile.maxTargetTimeHours = 0;
     else
-      _vars.maxTargetTimeHours = maxTargetTimeHours;
+      _vars.profile.maxTargetTimeHours = maxTargetTimeHours;
   }
   
 //  char getMinTargetTimeHours() { return _vars.minTargetTimeHours; }
@@ -133,7 +257,21 @@ public:
 //  }
   
 private:
+  byte storedVersion();
+  boolean migrateConfig(byte version);
+  void loadProfile(byte slot);
+  void defaultProfileName(byte slot, char *name);
+  int profileAddress(byte slot) { return PROFILES_START + slot * sizeof(ProfileStruct); }
+  int readField(const SettingsField &field);
+  void writeField(const SettingsField &field, int value);
+  
   SettingsStoreStruct _vars;
+  
+  //background save state
+  boolean _dirty;
+  unsigned long _lastChange;
+  unsigned int _persistPos;
+  byte _profileRequest; //slot + 1 waiting to be loaded, 0 for none
 };
 
 extern SettingsClass Settings;
@@ -0,0 +1,150 @@
+/**************************************************
+ * class: Telemetry
+ * constructor: none, call sendTelemetry() from the background task
+ *
+ * Sends a record of the controller state every telemetryPeriod seconds.
+ * In binary mode a record is a TelemetryRecord followed by its Dallas
+ * CRC-8, COBS encoded between two 0x00, the only zeros in a frame, so a
+ * reader joining mid stream syncs on the next one and text that got onto
+ * the port in between spoils nothing but itself. Multi-byte values are
+ * little endian, temperatures are 0.01*C. Text mode prints the same values
+ * as a line for a terminal. Records go through LogSink; those it had to
+ * drop are counted in the next one that gets through.
+ *
+ * methods:
+ *   sendTelemetry()
+ **************************************************/
+
+#define TELEMETRY_VERSION  2
+#define TELEMETRY_NO_VALUE ((int)0x8000) //temperature not available
+
+// flags
+#define TELEMETRY_TIME_SET  0x01 //the clock has been set
+#define TELEMETRY_TIME_SYNC 0x02 //and the last sync worked
+#define TELEMETRY_SAVING    0x04 //settings waiting to be written
+#define TELEMETRY_PROFILE   0x08 //a profile change is pending
+#define TELEMETRY_TRIPPED   0x10 //the Safety interlock has cut the heater
+
+struct TelemetryRecord {
+  byte version;
+  byte time[6];    //ms since 1970, from monoTime()
+  int temp;
+  int rtcTemp;
+  int setpoint;
+  byte relay;
+  byte flags;
+  byte dropped;    //log records lost since the last one sent, saturates
+};
+
+static TelemetryRecord telemetry;
+static byte telemetryCount;
+
+void sendTelemetry() {
+  if (Settings.getTelemetryMode() == TELEMETRY_OFF || ++telemetryCount < Settings.getTelemetryPeriod()) {
+    return;
+  }
+  telemetryCount = 0;
+  
+  TelemetryRecord &r = telemetry;
+  uint64_t stamp = monoTime();
+  r.version = TELEMETRY_VERSION;
+  for (byte i = 0; i < sizeof(r.time); i++) {
+    r.time[i] = stamp >> (8 * i);
+  }
+  r.temp = telemetryTemp(tempC);
+  r.rtcTemp = telemetryTemp(getClockTemperature());
+  r.setpoint = telemetryTemp(getTargetTemp());
+  r.relay = getRelayStatus();
+  r.flags = 0;
+  if (timeStatus() != timeNotSet) r.flags |= TELEMETRY_TIME_SET;
+  if (timeStatus() == timeSet) r.flags |= TELEMETRY_TIME_SYNC;
+  if (Settings.isSaving()) r.flags |= TELEMETRY_SAVING;
+  if (Settings.isProfilePending()) r.flags |= TELEMETRY_PROFILE;
+  if (safetyTripped()) r.flags |= TELEMETRY_TRIPPED;
+  unsigned int dropped = min(LogSink.getDropped(), 255);
+  r.dropped = dropped;
+  
+  LogSink.beginRecord();
+  if (Settings.getTelemetryMode() == TELEMETRY_TEXT) {
+    printTelemetry(stamp);
+  }
+  else {
+    byte frame[sizeof(r) + 1];
+    byte encoded[sizeof(frame) + 3];
+    memcpy(frame, &r, sizeof(r));
+    frame[sizeof(r)] = OneWire::crc8(frame, sizeof(r));
+    //zero on both sides: stray text before it ends at the first one, not in this frame
+    encoded[0] = 0;
+    byte len = cobsEncode(frame, sizeof(frame), encoded + 1) + 1;
+    encoded[len++] = 0;
+    LogSink.write(encoded, len);
+  }
+  if (LogSink.endRecord()) {
+    LogSink.clearDropped(dropped);
+  }
+}
+
+int telemetryTemp(float tempC) {
+  if (tempC == -127) {
+    return TELEMETRY_NO_VALUE;
+  }
+  return tempC * 100;
+}
+
+// COBS: each zero becomes the distance to the next one, the block starts
+// with the distance to the first. Blocks up to 253 bytes, out gets len + 1.
+byte cobsEncode(const byte *in, byte len, byte *out) {
+  byte code = 1;
+  byte codePos = 0;
+  byte o = 1;
+  
+  for (byte i = 0; i < len; i++) {
+    if (in[i] == 0) {
+      out[codePos] = code;
+      code = 1;
+      codePos = o++;
+    }
+    else {
+      out[o++] = in[i];
+      code++;
+    }
+  }
+  out[codePos] = code;
+  return o;
+}
+
+void printTelemetry(uint64_t stamp) {
+  const TelemetryRecord &r = telemetry;
+  time_t t = stamp / 1000;
+  int ms = stamp % 1000;
+  
+  LogSink.print(year(t));LogSink.print("/");
+  logPrintDigits(month(t));LogSink.print("/");
+  logPrintDigits(day(t));LogSink.print(" ");
+  logPrintDigits(hour(t));LogSink.print(":");
+  logPrintDigits(minute(t));LogSink.print(":");
+  logPrintDigits(second(t));LogSink.print(".");
+  if (ms < 100) LogSink.print('0');
+  logPrintDigits(ms);
+  
+  printTelemetryTemp(", temp = ", r.temp);
+  printTelemetryTemp(", rtcTemp = ", r.rtcTemp);
+  printTelemetryTemp(", targetTemp = ", r.setpoint);
+  LogSink.print(", relayStatus = ");
+  LogSink.print(r.relay, DEC);
+  LogSink.print(", flags = ");
+  LogSink.print(r.flags, HEX);
+  if (r.dropped) {
+    LogSink.print(", dropped = ");
+    LogSink.print(r.dropped, DEC);
+  }
+  LogSink.println();
+}
+
+void printTelemetryTemp(const char *label, int value) {
+  if (value == TELEMETRY_NO_VALUE) {
+    return;
+  }
+  LogSink.print(label);
+  LogSink.print(value / 100.0);
+}
@@ -8,7 +8,7 @@
 
 
 // Setup a oneWire instance to communicate with any OneWire devices (not just Maxim/Dallas temperature ICs)
-OneWire oneWire(ONE_WIRE_BUS);
+OneWirePin<ONE_WIRE_BUS> oneWire;
 
 // Pass our oneWire reference to Dallas Temperature. 
 DallasTemperature tempSensor(&oneWire);
@@ -16,29 +16,88 @@ DallasTemperature tempSensor(&oneWire);
 // arrays to hold device address
 DeviceAddress tAddr;
 
+#define EARLY_CONVERSION_TIME 94  //ms, 9 bit
+#define FULL_CONVERSION_TIME  750 //ms, 12 bit
+
+static byte earlyConfig[3];   //TH TL configuration, put back after the early conversion
+static boolean earlyConfigSet;
+
+//enumerates the bus, the first reading is left for backgroundTasks()
 void initTempSensor() {
   tempSensor.begin();
   tempSensor.setWaitForConversion(false);
   
+  LogSink.beginRecord();
   if (!tempSensor.getAddress(tAddr, 0)) {
-    Serial.println("Unable to find address for Device 0"); 
+    LogSink.println("Unable to find address for Device 0"); 
   }
-  
   printAddress(tAddr);
+  LogSink.endRecord();
+}
+
+// First thing at boot, before the bus is enumerated: a conversion on every
+// sensor at 9 bits, ready in 94ms instead of 750ms, so control can start
+// on a real reading. The resolution is only changed in the scratchpad, no
+// COPYSCRATCH, the sensor's EEPROM isn't written. With more than one
+// sensor the scratchpad reads collide and the stored resolution is used.
+// Returns the ms to wait before endEarlyConversion()
+unsigned int startEarlyConversion() {
+  byte scratchPad[9];
+  boolean parasite;
   
-  requestTemperatures();
+  earlyConfigSet = false;
+  if (!oneWire.reset()) {
+    return 0;
+  }
+  oneWire.skip();
+  oneWire.write(READPOWERSUPPLY);
+  parasite = !oneWire.read_bit();
+  
+  oneWire.reset();
+  oneWire.skip();
+  oneWire.write(READSCRATCH);
+  oneWire.read_bytes(scratchPad, sizeof(scratchPad));
+  //a DS18B20 family configuration register, a DS18S20 has none
+  if (OneWire::crc8(scratchPad, 8) == scratchPad[8] && (scratchPad[4] & 0x9F) == TEMP_9_BIT) {
+    memcpy(earlyConfig, scratchPad + 2, sizeof(earlyConfig));
+    earlyConfigSet = true;
+    writeSensorConfig(earlyConfig[0], earlyConfig[1], TEMP_9_BIT);
+  }
+  
+  oneWire.reset();
+  oneWire.skip();
+  oneWire.write(STARTCONVO, parasite);
+  return earlyConfigSet ? EARLY_CONVERSION_TIME : FULL_CONVERSION_TIME;
+}
+
+//the conversion is done, back to the sensor's own resolution
+void endEarlyConversion() {
+  if (earlyConfigSet) {
+    writeSensorConfig(earlyConfig[0], earlyConfig[1], earlyConfig[2]);
+    earlyConfigSet = false;
+  }
+}
+
+void writeSensorConfig(byte th, byte tl, byte config) {
+  oneWire.reset();
+  oneWire.skip();
+  oneWire.write(WRITESCRATCH);
+  oneWire.write(th);
+  oneWire.write(tl);
+  oneWire.write(config);
+  oneWire.reset();
 }
 
 // function to print a device address
 void printAddress(DeviceAddress deviceAddress)
 {
-  Serial.print("Found device with id: ");
+  LogSink.print("Found device with id: ");
   for (uint8_t i = 0; i < 8; i++)
   {
-    if (deviceAddress[i] < 16) Serial.print("0");
-    Serial.print(deviceAddress[i], HEX);
+    if (deviceAddress[i] < 16) LogSink.print("0");
+    LogSink.print(deviceAddress[i], HEX);
   }
-  Serial.println();
+  LogSink.println();
 }
 
 
@@ -56,11 +115,5 @@ void requestTemperatures() {
 }
 
 float getTempC() {
-  float lastTempSensor = tempSensor.getTempC(tAddr);
-
-  Serial.print(", temp = ");  
-  Serial.print(lastTempSensor);
-//  Serial.println("* C");
-  
-  return lastTempSensor;
+  return tempSensor.getTempC(tAddr);
 }
@@ -0,0 +1,99 @@
+/**************************************************
+ * class: TimeSync
+ * constructor: none, fed by the protocol's TIME_SYNC command
+ *
+ * Disciplines the clock to a host that sends its time now and then.
+ * Offsets up to SYNC_STEP_LIMIT are slewed so relay and light edges don't
+ * jump, larger ones step the time and the RTC. The clock's rate against
+ * the host comes from a least squares fit over the last syncs and goes
+ * into the clockDrift setting, which Clock applies to the RTC.
+ *
+ * methods:
+ *   timeSync(time_t hostTime, int hostMs)
+ **************************************************/
+
+#define SYNC_STEP_LIMIT   2000  //ms, larger offsets are stepped
+#define SYNC_SAMPLES      8     //syncs in the drift fit
+#define SYNC_MIN_SAMPLES  4     //before a fit, SYNC_MIN_GAP (3h) apart at least
+#define SYNC_MIN_SPAN     86400 //s the fit must cover, the RTC only resolves whole seconds
+#define SYNC_MIN_GAP      (SYNC_MIN_SPAN / SYNC_SAMPLES) //s between samples, syncs in between only correct
+
+static time_t syncTimes[SYNC_SAMPLES];  //host time of each sample
+static long syncOffsets[SYNC_SAMPLES];  //offset the clock would have without our corrections, ms
+static byte syncCount;
+static long syncCorrected;              //ms the clock was moved by syncs since the first sample
+
+//Returns the offset of the clock to the host time in ms, positive if behind
+long timeSync(time_t hostTime, int hostMs) {
+  long offset = (long)(hostTime - now()) * 1000 + hostMs - millisecond();
+  
+  if (offset > SYNC_STEP_LIMIT || offset < -SYNC_STEP_LIMIT) {
+    //too far off to slew, the samples so far describe another clock.
+    //Step to the nearest second and slew the rest
+    time_t stepTo = hostTime + (hostMs >= 500 ? 1 : 0);
+    setTime(stepTo);
+    slewTime(hostMs >= 500 ? hostMs - 1000 : hostMs);
+    clockSet(stepTo);
+    syncCount = 0;
+    syncCorrected = 0;
+    return offset;
+  }
+  
+  if (syncCount == 0 || hostTime - syncTimes[syncCount - 1] >= SYNC_MIN_GAP) {
+    if (syncCount == SYNC_SAMPLES) {
+      memmove(syncTimes, syncTimes + 1, sizeof(syncTimes) - sizeof(syncTimes[0]));
+      memmove(syncOffsets, syncOffsets + 1, sizeof(syncOffsets) - sizeof(syncOffsets[0]));
+      syncCount--;
+    }
+    syncTimes[syncCount] = hostTime;
+    syncOffsets[syncCount] = offset + syncCorrected;
+    syncCount++;
+  }
+  
+  //what a running slew still adds is part of the offset already
+  long correction = offset - slewRemaining();
+  slewTime(correction);
+  syncCorrected += correction;
+  //keep the RTC within a second, or its syncs pull the time back
+  if (offset >= 1000 || offset <= -1000) {
+    clockSet(hostTime + (hostMs >= 500 ? 1 : 0));
+  }
+  
+  if (syncCount >= SYNC_MIN_SAMPLES && syncTimes[syncCount - 1] - syncTimes[0] >= SYNC_MIN_SPAN) {
+    updateClockDrift();
+  }
+  return offset;
+}
+
+//Fit a line through the samples, its slope is the clock's rate error
+void updateClockDrift() {
+  float meanX = 0, meanY = 0, sxy = 0, sxx = 0;
+  
+  for (byte i = 0; i < syncCount; i++) {
+    meanX += syncTimes[i] - syncTimes[0];
+    meanY += syncOffsets[i];
+  }
+  meanX /= syncCount;
+  meanY /= syncCount;
+  for (byte i = 0; i < syncCount; i++) {
+    float dx = (syncTimes[i] - syncTimes[0]) - meanX;
+    sxy += dx * (syncOffsets[i] - meanY);
+    sxx += dx * dx;
+  }
+  
+  //ms per s falling behind the host is the clock running slow, 1ms/s = 10000 * 0.1ppm
+  float slope = sxy / sxx;
+  Settings.setClockDrift(Settings.getClockDrift() - (int)(slope * 10000));
+  Settings.saveConfig();
+  applyClockDrift();
+  
+  LogSink.beginRecord();
+  LogSink.print("Clock drift now ");
+  LogSink.print(Settings.getClockDrift() / 10.0);
+  LogSink.println("ppm");
+  LogSink.endRecord();
+  
+  //the correction changed the clock's rate, start over
+  syncCount = 0;
+  syncCorrected = 0;
+}
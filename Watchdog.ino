@@ -0,0 +1,144 @@
+/**************************************************
+ * class: Watchdog
+ * constructor: initWatchdog()
+ *
+ * A hang must not leave the heater on. The hardware watchdog resets the
+ * board unless it is fed, and it is only fed once every task in
+ * WATCHDOG_TASKS has checked in since the last feed: a stuck loop, a bus
+ * lockup in the background tasks or a dead timer tick all stop the
+ * feeding. Needs a bootloader that clears the watchdog (optiboot, the
+ * Uno's), an old one keeps resetting.
+ *
+ * The reset cause is taken before main(), and the relay and triac pins are
+ * driven low right then. Optiboot clears MCUSR itself: the Uno's 4.4 loses
+ * the cause, so watchdog resets only show up with optiboot 6.2 or later,
+ * which hands it on in r2. watchdogMark() keeps the step running in RAM
+ * that survives a reset; after a watchdog or brown-out reset both go to
+ * the crash record in EEPROM. Not with power-on also set, a brown-out
+ * comes with every slow power-up.
+ *
+ * The outputs stay inhibited until the sensor gives a real reading, and
+ * again whenever it stops giving one: -127 is a missing sensor, 85 the
+ * DS18B20's power-on value before a conversion. Valid readings feed the
+ * Safety interlock.
+ *
+ * methods:
+ *   initWatchdog()
+ *   watchdogCheckIn(byte task)
+ *   watchdogMark(byte step)
+ *   validateSensor(float temp)
+ *   outputsInhibited()
+ **************************************************/
+
+#include <avr/wdt.h>
+
+#define WATCHDOG_TIMEOUT       WDTO_8S  //covers setup too
+#define WATCHDOG_EEPROM_START  0        //before the settings
+#define CRASH_RECORD_VERSION   1
+#define SENSOR_POWER_ON_TEMP   85
+
+struct CrashRecord {
+  byte version;
+  byte resetCause;    //MCUSR, or r2 from optiboot, at the last crash
+  byte lastStep;      //WATCHDOG_MARK_* running then, 0 if unknown
+  unsigned int count; //crashes so far
+  byte crc;           //Dallas CRC-8 of the bytes before
+};
+
+CONFIG_CHECK(WATCHDOG_EEPROM_START + sizeof(CrashRecord) <= CONFIG_START);
+
+// not cleared by the C runtime, they have to get through the reset
+static byte resetCause __attribute__ ((section(".noinit")));
+static byte lastStep __attribute__ ((section(".noinit")));
+static byte lastStepCheck __attribute__ ((section(".noinit"))); //~lastStep, tells a marker from power-on garbage
+
+static byte watchdogCheckIns;
+static boolean sensorValid;
+
+void saveResetCause() __attribute__ ((naked, used, section(".init3")));
+
+// .init3 runs before main(). The watchdog stays on after it resets the
+// board, it has to go before the rest of the boot outlasts it
+void saveResetCause() {
+  RelayPin::low();
+  RelayPin::output();
+  TriacPin::low();
+  TriacPin::output();
+
+  resetCause = MCUSR;
+  if (resetCause == 0) {
+    //cleared by optiboot, which passes it on in r2 since 6.2
+    asm volatile ("mov %0, r2" : "=r" (resetCause));
+    resetCause &= _BV(WDRF) | _BV(BORF) | _BV(EXTRF) | _BV(PORF);
+  }
+  MCUSR = 0;
+  wdt_disable();
+}
+
+void initWatchdog() {
+  byte step = (byte)~lastStepCheck == lastStep ? lastStep : 0;
+  CrashRecord crashRecord;
+
+  Serial.print("Reset cause: ");
+  Serial.print(resetCause, HEX);
+
+  if ((resetCause & (_BV(WDRF) | _BV(BORF))) && !(resetCause & _BV(PORF))) {
+    for (byte i = 0; i < sizeof(crashRecord); i++) {
+      *((byte*)&crashRecord + i) = EEPROM.read(WATCHDOG_EEPROM_START + i);
+    }
+    if (crashRecord.version != CRASH_RECORD_VERSION
+        || OneWire::crc8((uint8_t*)&crashRecord, sizeof(crashRecord) - 1) != crashRecord.crc) {
+      crashRecord.count = 0;
+    }
+    crashRecord.version = CRASH_RECORD_VERSION;
+    crashRecord.resetCause = resetCause;
+    crashRecord.lastStep = step;
+    crashRecord.count++;
+    crashRecord.crc = OneWire::crc8((uint8_t*)&crashRecord, sizeof(crashRecord) - 1);
+    //a few ms at boot, the rest of the EEPROM writes are spread over the loop
+    for (byte i = 0; i < sizeof(crashRecord); i++) {
+      if (EEPROM.read(WATCHDOG_EEPROM_START + i) != *((byte*)&crashRecord + i)) {
+        EEPROM.write(WATCHDOG_EEPROM_START + i, *((byte*)&crashRecord + i));
+      }
+    }
+
+    Serial.print(", crash ");
+    Serial.print(crashRecord.count);
+    Serial.print(" in step ");
+    Serial.print(step);
+  }
+  Serial.println();
+
+  watchdogMark(WATCHDOG_MARK_SETUP);
+  wdt_enable(WATCHDOG_TIMEOUT);
+}
+
+// fed when all of WATCHDOG_TASKS have been through here since the last time
+void watchdogCheckIn(byte task) {
+  watchdogCheckIns |= task;
+  if ((watchdogCheckIns & WATCHDOG_TASKS) == WATCHDOG_TASKS) {
+    wdt_reset();
+    watchdogCheckIns = 0;
+  }
+}
+
+void watchdogMark(byte step) {
+  lastStep = step;
+  lastStepCheck = ~step;
+}
+
+// every new reading
+void validateSensor(float temp) {
+  sensorValid = temp != DEVICE_DISCONNECTED && temp != SENSOR_POWER_ON_TEMP;
+  if (sensorValid) {
+    safetyReading(temp);
+  }
+  if (outputsInhibited()) {
+    relay(RELAY_OFF);
+  }
+}
+
+// also while the Safety interlock is tripped
+boolean outputsInhibited() {
+  return !sensorValid || safetyTripped();
+}
@@ -20,105 +20,121 @@
   
   30 Dec 2009 - Initial release
   5 Sep 2011 updated for Arduino 1.0
+  moved from Wire to the interrupt driven TwiAsync, added getAsync()
+  register access and BCD shared with DS3231RTC in DSRTC
  */
 
-#include <Wire.h>
+#if ARDUINO >= 100
+#include <Arduino.h> 
+#else
+#include <WProgram.h> 
+#endif
+#include <TwiAsync.h>
+#include <DSRTC.h>
 #include "DS1307RTC.h"
 
-#define DS1307_CTRL_ID 0x68 
+#define DS1307_CONTROL 0x07  // SQW/OUT control register
+#define DS1307_NVRAM   0x08  // first battery backed RAM register
+
+static TwiTransaction nvramWrite;
+static bool nvramBusy = false;
+
+static void nvramWriteDone(TwiTransaction &t)
+{
+  nvramBusy = false;
+}
 
 DS1307RTC::DS1307RTC()
 {
-  Wire.begin();
+  TwiAsync.begin();
 }
   
 // PUBLIC FUNCTIONS
 time_t DS1307RTC::get()   // Aquire data from buffer and convert to time_t
 {
   tmElements_t tm;
-  read(tm);
+  if (!read(tm))
+    return 0;
   return(makeTime(tm));
 }
 
+// Sync provider that never waits for the bus: starts a read and returns 0
+// (not available) until it completes, the Time library asks again
+time_t DS1307RTC::getAsync()
+{
+  return DSRTC::getAsync();
+}
+
 void  DS1307RTC::set(time_t t)
 {
   tmElements_t tm;
   breakTime(t, tm);
-  tm.Second |= 0x80;  // stop the clock 
-  write(tm); 
-  tm.Second &= 0x7f;  // start the clock
-  write(tm); 
+  write(tm);  // writing the seconds restarts the clock's divider, no need to stop it first
 }
 
 // Aquire data from the RTC chip in BCD format
-void DS1307RTC::read( tmElements_t &tm)
+bool DS1307RTC::read( tmElements_t &tm)
 {
-  Wire.beginTransmission(DS1307_CTRL_ID);
-#if ARDUINO >= 100  
-  Wire.write((uint8_t)0x00); 
-#else
-  Wire.send(0x00);
-#endif  
-  Wire.endTransmission();
-
-  // request the 7 data fields   (secs, min, hr, dow, date, mth, yr)
-  Wire.requestFrom(DS1307_CTRL_ID, tmNbrFields);
-#if ARDUINO >= 100    
-  tm.Second = bcd2dec(Wire.read() & 0x7f);   
-  tm.Minute = bcd2dec(Wire.read() );
-  tm.Hour =   bcd2dec(Wire.read() & 0x3f);  // mask assumes 24hr clock
-  tm.Wday = bcd2dec(Wire.read() );
-  tm.Day = bcd2dec(Wire.read() );
-  tm.Month = bcd2dec(Wire.read() );
-  tm.Year = y2kYearToTm((bcd2dec(Wire.read())));
-#else
-  tm.Second = bcd2dec(Wire.receive() & 0x7f);   
-  tm.Minute = bcd2dec(Wire.receive() );
-  tm.Hour =   bcd2dec(Wire.receive() & 0x3f);  // mask assumes 24hr clock
-  tm.Wday = bcd2dec(Wire.receive() );
-  tm.Day = bcd2dec(Wire.receive() );
-  tm.Month = bcd2dec(Wire.receive() );
-  tm.Year = y2kYearToTm((bcd2dec(Wire.receive())));
-#endif  
+  return DSRTC::readTime(tm);
 }
 
-void DS1307RTC::write(tmElements_t &tm)
+bool DS1307RTC::write(tmElements_t &tm)
 {
-  Wire.beginTransmission(DS1307_CTRL_ID);
-#if ARDUINO >= 100  
-  Wire.write((uint8_t)0x00); // reset register pointer  
-  Wire.write(dec2bcd(tm.Second)) ;   
-  Wire.write(dec2bcd(tm.Minute));
-  Wire.write(dec2bcd(tm.Hour));      // sets 24 hour format
-  Wire.write(dec2bcd(tm.Wday));   
-  Wire.write(dec2bcd(tm.Day));
-  Wire.write(dec2bcd(tm.Month));
-  Wire.write(dec2bcd(tmYearToY2k(tm.Year))); 
-#else  
-  Wire.send(0x00); // reset register pointer  
-  Wire.send(dec2bcd(tm.Second)) ;   
-  Wire.send(dec2bcd(tm.Minute));
-  Wire.send(dec2bcd(tm.Hour));      // sets 24 hour format
-  Wire.send(dec2bcd(tm.Wday));   
-  Wire.send(dec2bcd(tm.Day));
-  Wire.send(dec2bcd(tm.Month));
-  Wire.send(dec2bcd(tmYearToY2k(tm.Year)));   
-#endif
-  Wire.endTransmission();  
+  return DSRTC::writeTime(tm);
 }
-// PRIVATE FUNCTIONS
 
-// Convert Decimal to Binary Coded Decimal (BCD)
-uint8_t DS1307RTC::dec2bcd(uint8_t num)
+// Drive the SQW/OUT pin, one of the DS1307_SQW_ modes.
+// The output is open drain and its 1Hz falling edge comes with the seconds update
+void DS1307RTC::setSquareWave(uint8_t mode)
 {
-  return ((num/10 * 16) + (num % 10));
+  DSRTC::writeRegs(DS1307_CONTROL, &mode, 1);
 }
 
-// Convert Binary Coded Decimal (BCD) to Decimal
-uint8_t DS1307RTC::bcd2dec(uint8_t num)
+// Read len bytes of battery backed RAM from offset (0-55).
+// Returns the number of bytes read
+uint8_t DS1307RTC::readNVRAM(uint8_t offset, uint8_t *data, uint8_t len)
 {
-  return ((num/16 * 10) + (num % 16));
+  if (offset >= DS1307_NVRAM_SIZE)
+    return 0;
+  if (len > DS1307_NVRAM_SIZE - offset)
+    len = DS1307_NVRAM_SIZE - offset;
+    
+  return DSRTC::readRegs(DS1307_NVRAM + offset, data, len) ? len : 0;
 }
 
-DS1307RTC RTC = DS1307RTC(); // create an instance for the user
+// Write len bytes of battery backed RAM at offset (0-55).
+// Returns the number of bytes written
+uint8_t DS1307RTC::writeNVRAM(uint8_t offset, const uint8_t *data, uint8_t len)
+{
+  if (offset >= DS1307_NVRAM_SIZE)
+    return 0;
+  if (len > DS1307_NVRAM_SIZE - offset)
+    len = DS1307_NVRAM_SIZE - offset;
+    
+  return DSRTC::writeRegs(DS1307_NVRAM + offset, data, len) ? len : 0;
+}
 
+// Start writing battery backed RAM in the background. data must stay valid
+// until isNVRAMBusy() is false. Returns false if the previous write is still
+// running or the range is outside the RAM
+bool DS1307RTC::writeNVRAMAsync(uint8_t offset, const uint8_t *data, uint8_t len)
+{
+  if (nvramBusy || offset >= DS1307_NVRAM_SIZE)
+    return false;
+  if (len > DS1307_NVRAM_SIZE - offset)
+    len = DS1307_NVRAM_SIZE - offset;
+    
+  DSRTC::prepare(nvramWrite, DS1307_NVRAM + offset);
+  nvramWrite.txData = data;
+  nvramWrite.txLen = len;
+  nvramWrite.callback = nvramWriteDone;
+  nvramBusy = TwiAsync.queue(nvramWrite);
+  return nvramBusy;
+}
+
+bool DS1307RTC::isNVRAMBusy()
+{
+  return nvramBusy;
+}
+
+DS1307RTC RTC = DS1307RTC(); // create an instance for the user
@@ -7,6 +7,17 @@
 #define DS1307RTC_h
 
 #include <Time.h>
+#include <TwiAsync.h>
+
+// SQW/OUT pin modes for setSquareWave()
+#define DS1307_SQW_LOW   0x00
+#define DS1307_SQW_HIGH  0x80
+#define DS1307_SQW_1HZ   0x10
+#define DS1307_SQW_4KHZ  0x11
+#define DS1307_SQW_8KHZ  0x12
+#define DS1307_SQW_32KHZ 0x13
+
+#define DS1307_NVRAM_SIZE 56  // battery backed RAM bytes
 
 // library interface description
 class DS1307RTC
@@ -15,13 +26,15 @@ class DS1307RTC
   public:
     DS1307RTC();
     static time_t get();
+    static time_t getAsync();
 	static void set(time_t t);
-	static void read(tmElements_t &tm);
-	static void write(tmElements_t &tm);
-
-  private:
-	static uint8_t dec2bcd(uint8_t num);
-    static uint8_t bcd2dec(uint8_t num);
+	static bool read(tmElements_t &tm);
+	static bool write(tmElements_t &tm);
+	static void setSquareWave(uint8_t mode);
+	static uint8_t readNVRAM(uint8_t offset, uint8_t *data, uint8_t len);
+	static uint8_t writeNVRAM(uint8_t offset, const uint8_t *data, uint8_t len);
+	static bool writeNVRAMAsync(uint8_t offset, const uint8_t *data, uint8_t len);
+	static bool isNVRAMBusy();
 };
 
 extern DS1307RTC RTC;
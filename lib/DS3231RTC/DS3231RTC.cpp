@@ -0,0 +1,139 @@
+/*
+ * DS3231RTC.cpp - library for DS3231 RTC
+  
+  Based on DS1307RTC, Copyright (c) Michael Margolis 2009
+  This library is intended to be uses with Arduino Time.h library functions
+
+  The library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#if ARDUINO >= 100
+#include <Arduino.h> 
+#else
+#include <WProgram.h> 
+#endif
+#include <TwiAsync.h>
+#include <DSRTC.h>
+#include "DS3231RTC.h"
+
+#define DS3231_CONTROL 0x0E
+#define DS3231_STATUS  0x0F  // bits 6..4 always read 0
+#define DS3231_AGING   0x10  // signed, one step is about 0.1ppm, positive slows the clock
+#define DS3231_TEMP    0x11  // signed MSB, quarter degrees in the top bits of 0x12
+
+#define DS3231_STATUS_ZERO 0x70
+
+static uint8_t asyncTemp[2];
+static DSRTCAsyncRead asyncTempRead(DS3231_TEMP, asyncTemp, 2);
+
+DS3231RTC::DS3231RTC()
+{
+  TwiAsync.begin();
+}
+  
+// PUBLIC FUNCTIONS
+
+// Tell a DS3231 from a DS1307 at the same address: the status register's
+// bits 6..4 stay 0 whatever is written, on a DS1307 the same address is
+// plain NVRAM. The flags in there only clear on a 0, writing their value
+// back changes nothing, and the byte is put back either way
+bool DS3231RTC::detect()
+{
+  uint8_t status, probe;
+  
+  if (!DSRTC::readRegs(DS3231_STATUS, &status, 1))
+    return false;
+  probe = status | DS3231_STATUS_ZERO;
+  if (!DSRTC::writeRegs(DS3231_STATUS, &probe, 1) || !DSRTC::readRegs(DS3231_STATUS, &probe, 1))
+    return false;
+  DSRTC::writeRegs(DS3231_STATUS, &status, 1);
+  return (probe & DS3231_STATUS_ZERO) == 0;
+}
+
+time_t DS3231RTC::get()   // Aquire data from buffer and convert to time_t
+{
+  tmElements_t tm;
+  if (!read(tm))
+    return 0;
+  return(makeTime(tm));
+}
+
+// Sync provider that never waits for the bus: starts a read and returns 0
+// (not available) until it completes, the Time library asks again
+time_t DS3231RTC::getAsync()
+{
+  return DSRTC::getAsync();
+}
+
+void DS3231RTC::set(time_t t)
+{
+  tmElements_t tm;
+  breakTime(t, tm);
+  write(tm);
+}
+
+bool DS3231RTC::read(tmElements_t &tm)
+{
+  return DSRTC::readTime(tm);
+}
+
+bool DS3231RTC::write(tmElements_t &tm)
+{
+  return DSRTC::writeTime(tm);
+}
+
+// Drive the SQW/INT pin, one of the DS3231_SQW_ modes. The oscillator stays
+// on and the alarm interrupts off. The output is open drain
+void DS3231RTC::setSquareWave(uint8_t mode)
+{
+  DSRTC::writeRegs(DS3231_CONTROL, &mode, 1);
+}
+
+int8_t DS3231RTC::getAging()
+{
+  uint8_t offset = 0;
+  DSRTC::readRegs(DS3231_AGING, &offset, 1);
+  return (int8_t)offset;
+}
+
+// Trim the crystal, one step is about 0.1ppm (8.6ms a day) at 25C.
+// Applied with the next temperature conversion, within 64s
+void DS3231RTC::setAging(int8_t offset)
+{
+  uint8_t value = (uint8_t)offset;
+  DSRTC::writeRegs(DS3231_AGING, &value, 1);
+}
+
+// The chip's own sensor in C with 0.25C resolution, converted every 64s.
+// Returns -127 (like DallasTemperature) if the chip doesn't answer
+float DS3231RTC::getTemperature()
+{
+  uint8_t regs[2];
+  if (!DSRTC::readRegs(DS3231_TEMP, regs, 2))
+    return -127;
+  return (int16_t)((regs[0] << 8) | regs[1]) / 256.0;
+}
+
+// The same without waiting for the bus: starts a read and returns false
+// until it completes, then true once with temp set
+bool DS3231RTC::getTemperatureAsync(float &temp)
+{
+  if (!asyncTempRead.poll())
+    return false;
+  temp = (int16_t)((asyncTemp[0] << 8) | asyncTemp[1]) / 256.0;
+  return true;
+}
+
+DS3231RTC RTC3231 = DS3231RTC(); // create an instance for the user
@@ -0,0 +1,42 @@
+/*
+ * DS3231RTC.h - library for DS3231 RTC
+ * Same interface as DS1307RTC, plus the aging offset and the on-chip
+ * temperature sensor. This library is intended to be uses with Arduino
+ * Time.h library functions
+ */
+
+#ifndef DS3231RTC_h
+#define DS3231RTC_h
+
+#include <Time.h>
+#include <TwiAsync.h>
+
+// SQW/INT pin modes for setSquareWave()
+#define DS3231_SQW_OFF   0x04  // INTCN set, pin only signals alarms
+#define DS3231_SQW_1HZ   0x00
+#define DS3231_SQW_1KHZ  0x08
+#define DS3231_SQW_4KHZ  0x10
+#define DS3231_SQW_8KHZ  0x18
+
+// library interface description
+class DS3231RTC
+{
+  // user-accessible "public" interface
+  public:
+    DS3231RTC();
+    static bool detect();
+    static time_t get();
+    static time_t getAsync();
+    static void set(time_t t);
+    static bool read(tmElements_t &tm);
+    static bool write(tmElements_t &tm);
+    static void setSquareWave(uint8_t mode);
+    static int8_t getAging();
+    static void setAging(int8_t offset);
+    static float getTemperature();
+    static bool getTemperatureAsync(float &temp);
+};
+
+extern DS3231RTC RTC3231;
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ * DSRTC.cpp - what DS1307RTC and DS3231RTC share
+
+  Based on DS1307RTC, Copyright (c) Michael Margolis 2009
+  This library is intended to be uses with Arduino Time.h library functions
+
+  The library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <TwiAsync.h>
+#include "DSRTC.h"
+
+// state of a read that runs in the background
+#define ASYNC_IDLE  0
+#define ASYNC_BUSY  1
+#define ASYNC_READY 2
+
+static void asyncReadDone(TwiTransaction &t)
+{
+  DSRTCAsyncRead &r = static_cast<DSRTCAsyncRead&>(t);
+  r.doneAt = millis();
+  r.state = ASYNC_READY;
+}
+
+DSRTCAsyncRead::DSRTCAsyncRead(uint8_t reg, uint8_t *data, uint8_t len)
+{
+  DSRTC::prepare(*this, reg);
+  rxData = data;
+  rxLen = len;
+  callback = asyncReadDone;
+  state = ASYNC_IDLE;
+}
+
+bool DSRTCAsyncRead::poll()
+{
+  if (state == ASYNC_BUSY)
+    return false;
+  if (state == ASYNC_READY) {
+    state = ASYNC_IDLE;
+    if (status == TWI_DONE)
+      return true;
+  }
+  if (TwiAsync.queue(*this))
+    state = ASYNC_BUSY;
+  return false;
+}
+
+unsigned long DSRTCAsyncRead::age()
+{
+  return millis() - doneAt;
+}
+
+static uint8_t asyncRegs[tmNbrFields];
+static DSRTCAsyncRead asyncTime(0x00, asyncRegs, tmNbrFields);
+
+// Sync provider that never waits for the bus: starts a read and returns 0
+// (not available) until it completes, the Time library asks again
+time_t DSRTC::getAsync()
+{
+  if (!asyncTime.poll())
+    return 0;
+  tmElements_t tm;
+  decode(asyncRegs, tm);
+  // the loop may have been busy since the transfer completed
+  return makeTime(tm) + asyncTime.age() / 1000;
+}
+
+bool DSRTC::readTime(tmElements_t &tm)
+{
+  uint8_t regs[tmNbrFields];  // secs, min, hr, dow, date, mth, yr
+
+  if (!readRegs(0x00, regs, tmNbrFields))
+    return false;
+  decode(regs, tm);
+  return true;
+}
+
+bool DSRTC::writeTime(tmElements_t &tm)
+{
+  uint8_t regs[tmNbrFields];
+
+  encode(tm, regs);
+  return writeRegs(0x00, regs, tmNbrFields);
+}
+
+bool DSRTC::readRegs(uint8_t reg, uint8_t *data, uint8_t len)
+{
+  TwiTransaction t;
+
+  prepare(t, reg);
+  t.rxData = data;
+  t.rxLen = len;
+  TwiAsync.queue(t);
+  return TwiAsync.wait(t) == TWI_DONE;
+}
+
+bool DSRTC::writeRegs(uint8_t reg, const uint8_t *data, uint8_t len)
+{
+  TwiTransaction t;
+
+  prepare(t, reg);
+  t.txData = data;
+  t.txLen = len;
+  TwiAsync.queue(t);
+  return TwiAsync.wait(t) == TWI_DONE;
+}
+
+// A transaction to the RTC starting at register reg, nothing to send or read yet
+void DSRTC::prepare(TwiTransaction &t, uint8_t reg)
+{
+  t.address = DSRTC_ADDRESS;
+  t.header[0] = reg;
+  t.headerLen = 1;
+  t.txData = 0;
+  t.txLen = 0;
+  t.rxData = 0;
+  t.rxLen = 0;
+  t.status = TWI_IDLE;
+  t.callback = 0;
+  t.next = 0;
+}
+
+// The masks drop the DS1307's clock halt bit and the DS3231's century bit,
+// both read as 0 where the other chip has nothing
+void DSRTC::decode(const uint8_t *regs, tmElements_t &tm)
+{
+  tm.Second = bcd2dec(regs[0] & 0x7f);
+  tm.Minute = bcd2dec(regs[1]);
+  tm.Hour =   bcd2dec(regs[2] & 0x3f);  // mask assumes 24hr clock
+  tm.Wday = bcd2dec(regs[3] & 0x07);
+  tm.Day = bcd2dec(regs[4]);
+  tm.Month = bcd2dec(regs[5] & 0x1f);
+  tm.Year = y2kYearToTm((bcd2dec(regs[6])));
+}
+
+// Clock halt and century bits cleared, 24 hour format
+void DSRTC::encode(const tmElements_t &tm, uint8_t *regs)
+{
+  regs[0] = dec2bcd(tm.Second) & 0x7f;
+  regs[1] = dec2bcd(tm.Minute);
+  regs[2] = dec2bcd(tm.Hour);
+  regs[3] = dec2bcd(tm.Wday);
+  regs[4] = dec2bcd(tm.Day);
+  regs[5] = dec2bcd(tm.Month);
+  regs[6] = dec2bcd(tmYearToY2k(tm.Year));
+}
+
+// Convert Decimal to Binary Coded Decimal (BCD)
+uint8_t DSRTC::dec2bcd(uint8_t num)
+{
+  return ((num/10 * 16) + (num % 10));
+}
+
+// Convert Binary Coded Decimal (BCD) to Decimal
+uint8_t DSRTC::bcd2dec(uint8_t num)
+{
+  return ((num/16 * 10) + (num % 16));
+}
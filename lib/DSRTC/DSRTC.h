@@ -0,0 +1,45 @@
+/*
+ * DSRTC.h - what DS1307RTC and DS3231RTC share
+ * Both chips answer at the same I2C address and keep the time in the same
+ * seven BCD registers from 0x00. Register access through TwiAsync, the
+ * BCD conversions and the background reads live here once.
+ */
+
+#ifndef DSRTC_h
+#define DSRTC_h
+
+#include <Time.h>
+#include <TwiAsync.h>
+
+#define DSRTC_ADDRESS 0x68  // DS1307 and DS3231 alike
+
+// A block of registers read in the background, again and again: poll()
+// starts a read and returns true once, with data filled in, when one
+// completes. The transaction itself is the base, the completion callback
+// finds its owner through it
+struct DSRTCAsyncRead : TwiTransaction
+{
+  DSRTCAsyncRead(uint8_t reg, uint8_t *data, uint8_t len);
+  bool poll();
+  unsigned long age();  // ms since the last read completed
+
+  uint8_t state;
+  unsigned long doneAt;
+};
+
+class DSRTC
+{
+  public:
+    static time_t getAsync();
+    static bool readTime(tmElements_t &tm);
+    static bool writeTime(tmElements_t &tm);
+    static bool readRegs(uint8_t reg, uint8_t *data, uint8_t len);
+    static bool writeRegs(uint8_t reg, const uint8_t *data, uint8_t len);
+    static void prepare(TwiTransaction &t, uint8_t reg);
+    static void decode(const uint8_t *regs, tmElements_t &tm);
+    static void encode(const tmElements_t &tm, uint8_t *regs);
+    static uint8_t dec2bcd(uint8_t num);
+    static uint8_t bcd2dec(uint8_t num);
+};
+
+#endif
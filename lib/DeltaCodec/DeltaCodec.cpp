@@ -0,0 +1,104 @@
+/*
+ * DeltaCodec.cpp - compact blocks for slowly changing time series
+ */
+
+#include "DeltaCodec.h"
+
+#define NIBBLES  ((DELTA_BLOCK_SIZE - DELTA_HEADER_SIZE) * 2)
+#define MORE     0x08
+
+void DeltaEncoder::begin(uint8_t *block, unsigned long time, int key)
+{
+  _block = block;
+  for (uint8_t i = 0; i < 4; i++)
+    block[i] = time >> (8 * i);
+  block[4] = 1;
+  block[5] = key & 0xff;
+  block[6] = (unsigned int)key >> 8;
+  for (uint8_t i = DELTA_HEADER_SIZE; i < DELTA_BLOCK_SIZE; i++)
+    block[i] = 0;
+  _nibble = 0;
+  _last = key;
+}
+
+bool DeltaEncoder::add(int value)
+{
+  // 16 bit, wrapping like the decoder's sum
+  int16_t delta = (uint16_t)value - (uint16_t)_last;
+  uint16_t zz = ((uint16_t)delta << 1) ^ (uint16_t)(delta >> 15);
+  
+  uint8_t needed = 1;
+  for (uint16_t rest = zz >> 3; rest != 0; rest >>= 3)
+    needed++;
+  if (_block[4] == DELTA_MAX_SAMPLES || _nibble + needed > NIBBLES)
+    return false;
+  
+  do {
+    uint8_t n = zz & 0x07;
+    zz >>= 3;
+    putNibble(zz != 0 ? n | MORE : n);
+  } while (zz != 0);
+  
+  _block[4]++;
+  _last = value;
+  return true;
+}
+
+void DeltaEncoder::putNibble(uint8_t n)
+{
+  uint8_t &b = _block[DELTA_HEADER_SIZE + _nibble / 2];
+  if (_nibble & 1)
+    b |= n << 4;
+  else
+    b |= n;
+  _nibble++;
+}
+
+void DeltaDecoder::begin(const uint8_t *block)
+{
+  _block = block;
+  _nibble = 0;
+  _read = 0;
+}
+
+unsigned long DeltaDecoder::time()
+{
+  unsigned long t = 0;
+  for (uint8_t i = 0; i < 4; i++)
+    t |= (unsigned long)_block[i] << (8 * i);
+  return t;
+}
+
+bool DeltaDecoder::next(int &value)
+{
+  if (_read >= count())
+    return false;
+    
+  if (_read == 0) {
+    _last = (int16_t)(_block[5] | _block[6] << 8);
+  }
+  else {
+    uint16_t zz = 0;
+    uint8_t shift = 0;
+    uint8_t n;
+    do {
+      if (_nibble >= NIBBLES || shift > 15)
+        return false;  // corrupt block, or more nibbles than 16 bits take
+      n = getNibble();
+      zz |= (uint16_t)(n & 0x07) << shift;
+      shift += 3;
+    } while (n & MORE);
+    int16_t delta = (zz >> 1) ^ -(int16_t)(zz & 1);
+    _last = (int16_t)((uint16_t)_last + (uint16_t)delta);
+  }
+  
+  _read++;
+  value = _last;
+  return true;
+}
+
+uint8_t DeltaDecoder::getNibble()
+{
+  uint8_t b = _block[DELTA_HEADER_SIZE + _nibble / 2];
+  return (_nibble++ & 1) ? b >> 4 : b & 0x0f;
+}
@@ -0,0 +1,56 @@
+/*
+ * DeltaCodec.h - compact blocks for slowly changing time series
+ *
+ * A block starts with a header holding the time of its first sample, the
+ * sample count and the first value as is (the keyframe), so any block
+ * decodes on its own. Each further value is stored as the zig-zag coded
+ * difference to the one before, in nibbles: three bits of the difference
+ * each, the high bit set when another nibble follows. A difference of
+ * -4..3 takes a single nibble, -32..31 two.
+ *
+ * Block layout, little endian:
+ *   time[4] count[1] key[2] nibbles..., two per byte, low nibble first
+ */
+
+#ifndef DeltaCodec_h
+#define DeltaCodec_h
+
+#include <inttypes.h>
+
+#define DELTA_BLOCK_SIZE   64
+#define DELTA_HEADER_SIZE  7
+#define DELTA_MAX_SAMPLES  255
+
+class DeltaEncoder
+{
+  public:
+    void begin(uint8_t *block, unsigned long time, int key);
+    bool add(int value);  // false if the block is full, value not stored
+    uint8_t count() { return _block[4]; }
+    
+  private:
+    void putNibble(uint8_t n);
+    
+    uint8_t *_block;
+    unsigned int _nibble;  // next free nibble after the header
+    int _last;
+};
+
+class DeltaDecoder
+{
+  public:
+    void begin(const uint8_t *block);
+    unsigned long time();
+    uint8_t count() { return _block[4]; }
+    bool next(int &value);  // false after the last sample
+    
+  private:
+    uint8_t getNibble();
+    
+    const uint8_t *_block;
+    unsigned int _nibble;
+    uint8_t _read;    // samples returned so far
+    int _last;
+};
+
+#endif
@@ -0,0 +1,93 @@
+/*
+ * DeltaCodecCheck.pde
+ * example code round tripping series through DeltaCodec blocks and
+ * reporting how many blocks they take.
+ *
+ * A day of minute readings in DS18B20 units (1/16*C) following a slow
+ * swing with a unit of jitter should fit 13 blocks, 832 bytes. Extremes
+ * and random values check the wide codes and the 16 bit wrap.
+ * tools/delta_codec_test.cpp runs the same checks on the build machine.
+ */
+
+#include <DeltaCodec.h>
+
+#define DAY_SAMPLES 1440
+
+uint8_t block[DELTA_BLOCK_SIZE];
+unsigned long errors;
+
+int daySample(int minute) {
+  return 16 * (24 + 4 * sin(2 * PI * minute / DAY_SAMPLES)) + (minute * 7 % 3) - 1;
+}
+
+int extremeSample(int i) {
+  static const int values[] = { 0, 32767, -32768, -32768, 32767, -1, 0, 1, -4, 3, -5, 4, -2032, 1360 };
+  return values[i % (sizeof(values) / sizeof(values[0]))];
+}
+
+int randomSample(int i) {
+  return random(-32768, 32767);
+}
+
+// encode count samples of series into blocks, decode each block as it
+// fills and compare. Returns the number of blocks used
+int roundTrip(int (*series)(int), int count) {
+  DeltaEncoder encoder;
+  DeltaDecoder decoder;
+  int blocks = 0;
+  int i = 0;
+  int expected[DELTA_MAX_SAMPLES];
+  
+  while (i < count) {
+    int first = i;
+    expected[0] = series(i);
+    encoder.begin(block, i, expected[0]);
+    i++;
+    while (i < count) {
+      int v = series(i);
+      if (!encoder.add(v))
+        break;
+      expected[i - first] = v;
+      i++;
+    }
+    blocks++;
+    
+    decoder.begin(block);
+    int v, n = 0;
+    while (decoder.next(v)) {
+      if (v != expected[n]) {
+        errors++;
+        Serial.print("Mismatch at ");
+        Serial.println(first + n);
+      }
+      n++;
+    }
+    if (n != i - first || decoder.time() != (unsigned long)first)
+      errors++;
+  }
+  return blocks;
+}
+
+void setup() {
+  Serial.begin(9600);
+  
+  unsigned long start = micros();
+  int blocks = roundTrip(daySample, DAY_SAMPLES);
+  unsigned long took = micros() - start;
+  Serial.print("Day of minutes: ");
+  Serial.print(blocks);
+  Serial.print(" blocks, ");
+  Serial.print(blocks * DELTA_BLOCK_SIZE);
+  Serial.print(" bytes, us per sample encoded and decoded: ");
+  Serial.println(took / DAY_SAMPLES);
+  
+  randomSeed(1);
+  roundTrip(extremeSample, 200);
+  roundTrip(randomSample, 2000);
+  
+  Serial.print("Done, errors: ");
+  Serial.println(errors);
+}
+
+void loop() {
+}
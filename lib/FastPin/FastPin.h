@@ -0,0 +1,50 @@
+/*
+ * FastPin.h - digital pins resolved at compile time
+ *
+ * FastPin<N>::high() is the same as digitalWrite(N, HIGH), but the port
+ * register and bit mask come from the template argument, so with
+ * optimisation on it compiles to a single sbi/cbi/sbis instruction instead
+ * of the pin table lookups digitalWrite() and digitalRead() do on every call.
+ * Being single instructions, high(), low() and toggle() are also safe to mix
+ * with an ISR writing other pins of the same port.
+ *
+ * Unlike digitalWrite() it doesn't turn off PWM on the pin, don't use it on
+ * a pin driven by analogWrite().
+ *
+ * Pin numbers follow the ATmega328P/168 Arduino boards: 0-7 PORTD,
+ * 8-13 PORTB, 14-19 (A0-A5) PORTC. Any other number fails to compile.
+ */
+
+#ifndef FastPin_h
+#define FastPin_h
+
+#include <inttypes.h>
+#include <avr/io.h>
+
+template <uint8_t PIN, bool VALID = (PIN < 20)>
+class FastPin;
+
+template <uint8_t PIN>
+class FastPin<PIN, true>
+{
+  public:
+    static const uint8_t mask = 1 << (PIN < 8 ? PIN : PIN < 14 ? PIN - 8 : PIN - 14);
+
+    static inline void output() { ddr() |= mask; }
+    static inline void input() { ddr() &= ~mask; port() &= ~mask; }
+    static inline void inputPullup() { ddr() &= ~mask; port() |= mask; }
+
+    static inline void high() { port() |= mask; }
+    static inline void low() { port() &= ~mask; }
+    static inline void set(uint8_t value) { if (value) high(); else low(); }
+    // writing a 1 to PINx flips the output bit
+    static inline void toggle() { pin() = mask; }
+    static inline uint8_t read() { return (pin() & mask) ? 1 : 0; }
+
+    // the registers themselves, for drivers needing other combinations
+    static inline volatile uint8_t &port() { return PIN < 8 ? PORTD : PIN < 14 ? PORTB : PORTC; }
+    static inline volatile uint8_t &ddr() { return PIN < 8 ? DDRD : PIN < 14 ? DDRB : DDRC; }
+    static inline volatile uint8_t &pin() { return PIN < 8 ? PIND : PIN < 14 ? PINB : PINC; }
+};
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * FastPinPulse.pde
+ * example code comparing FastPin with digitalWrite().
+ *
+ * Times a thousand pulses on pin 13 both ways and prints the averages, then
+ * mirrors the button on pin 2 (to ground, pulled up) on the LED.
+ */
+
+#include <FastPin.h>
+
+#define RUNS 1000
+
+typedef FastPin<13> Led;
+typedef FastPin<2> Button;
+
+void setup() {
+  Serial.begin(9600);
+  Led::output();
+  Button::inputPullup();
+
+  unsigned long start = micros();
+  for (int i = 0; i < RUNS; i++) {
+    digitalWrite(13, HIGH);
+    digitalWrite(13, LOW);
+  }
+  unsigned long slow = micros() - start;
+
+  start = micros();
+  for (int i = 0; i < RUNS; i++) {
+    Led::high();
+    Led::low();
+  }
+  unsigned long fast = micros() - start;
+
+  Serial.print("digitalWrite pulse ns: ");
+  Serial.println(slow * 1000 / RUNS);
+  Serial.print("FastPin pulse ns: ");
+  Serial.println(fast * 1000 / RUNS);
+}
+
+void loop() {
+  Led::set(!Button::read());
+}
@@ -0,0 +1,104 @@
+/*
+ * I2CEEPROM.cpp - 24LC256 class serial EEPROM on the TwiAsync bus
+ */
+
+#if ARDUINO >= 100
+#include <Arduino.h> 
+#else
+#include <WProgram.h> 
+#endif
+#include <TwiAsync.h>
+#include "I2CEEPROM.h"
+
+static TwiTransaction transfer;
+static bool busy = false;
+static bool writing = false;
+static unsigned long doneAt;
+
+static void transferDone(TwiTransaction &t)
+{
+  doneAt = millis();
+  busy = false;
+}
+
+I2CEEPROM::I2CEEPROM()
+{
+  TwiAsync.begin();
+}
+
+// Read len bytes at addr, waiting for the bus. Returns the number of bytes read
+uint8_t I2CEEPROM::read(unsigned int addr, uint8_t *data, uint8_t len)
+{
+  while (isBusy())
+    TwiAsync.poll();
+    
+  prepare(addr);
+  transfer.rxData = data;
+  transfer.rxLen = len;
+  TwiAsync.queue(transfer);
+  TwiAsync.wait(transfer);
+  return transfer.status == TWI_DONE ? len : 0;
+}
+
+// Start reading len bytes at addr. data must stay valid until isBusy() is
+// false, failed() tells how it went. Returns false if the chip is busy
+bool I2CEEPROM::readAsync(unsigned int addr, uint8_t *data, uint8_t len)
+{
+  if (isBusy())
+    return false;
+  prepare(addr);
+  transfer.rxData = data;
+  transfer.rxLen = len;
+  busy = TwiAsync.queue(transfer);
+  return busy;
+}
+
+// Start writing len bytes at addr, which must all be in one page: the
+// chip wraps within the page. data must stay valid until isBusy() is false.
+// Returns false if the chip is busy or the bytes cross a page
+bool I2CEEPROM::writeAsync(unsigned int addr, const uint8_t *data, uint8_t len)
+{
+  if (isBusy() || len == 0 || addr / I2CEEPROM_PAGE_SIZE != (addr + len - 1) / I2CEEPROM_PAGE_SIZE)
+    return false;
+  prepare(addr);
+  transfer.txData = data;
+  transfer.txLen = len;
+  busy = TwiAsync.queue(transfer);
+  writing = busy;
+  return busy;
+}
+
+bool I2CEEPROM::isBusy()
+{
+  if (busy)
+    return true;
+  if (writing && millis() - doneAt <= I2CEEPROM_WRITE_TIME)
+    return true;
+  writing = false;
+  return false;
+}
+
+// The last transfer didn't complete
+bool I2CEEPROM::failed()
+{
+  return transfer.status != TWI_DONE;
+}
+
+// PRIVATE FUNCTIONS
+
+void I2CEEPROM::prepare(unsigned int addr)
+{
+  transfer.address = I2CEEPROM_ADDRESS;
+  transfer.header[0] = addr >> 8;
+  transfer.header[1] = addr & 0xff;
+  transfer.headerLen = 2;
+  transfer.txData = 0;
+  transfer.txLen = 0;
+  transfer.rxData = 0;
+  transfer.rxLen = 0;
+  transfer.status = TWI_IDLE;
+  transfer.callback = transferDone;
+  transfer.next = 0;
+}
+
+I2CEEPROM ExtEEPROM = I2CEEPROM(); // create an instance for the user
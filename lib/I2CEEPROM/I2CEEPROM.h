@@ -0,0 +1,34 @@
+/*
+ * I2CEEPROM.h - 24LC256 class serial EEPROM on the TwiAsync bus
+ *
+ * Two byte memory addresses, page writes. Blocking reads for setup and
+ * background reads and writes for the loop; one background transfer at a
+ * time, isBusy() covers it and the chip's write cycle after a write.
+ */
+
+#ifndef I2CEEPROM_h
+#define I2CEEPROM_h
+
+#include <inttypes.h>
+
+#define I2CEEPROM_ADDRESS     0x50    // A0-A2 low
+#define I2CEEPROM_PAGE_SIZE   64      // 24LC256; 128 for a 24LC512
+#define I2CEEPROM_WRITE_TIME  5       // ms the chip is deaf after a write
+
+class I2CEEPROM
+{
+  public:
+    I2CEEPROM();
+    static uint8_t read(unsigned int addr, uint8_t *data, uint8_t len);
+    static bool readAsync(unsigned int addr, uint8_t *data, uint8_t len);
+    static bool writeAsync(unsigned int addr, const uint8_t *data, uint8_t len);
+    static bool isBusy();
+    static bool failed();
+
+  private:
+    static void prepare(unsigned int addr);
+};
+
+extern I2CEEPROM ExtEEPROM;
+
+#endif
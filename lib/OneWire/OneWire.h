@@ -92,13 +92,17 @@ class OneWire
     uint8_t LastDeviceFlag;
 #endif
 
+  protected:
+    // Let the bus float after a write without power.
+    virtual void release(void);
+
   public:
     OneWire( uint8_t pin);
 
     // Perform a 1-Wire reset cycle. Returns 1 if a device responds
     // with a presence pulse.  Returns 0 if there is no device or the
     // bus is shorted or otherwise held low for more than 250uS
-    uint8_t reset(void);
+    virtual uint8_t reset(void);
 
     // Issue a 1-Wire rom select command, you do the reset first.
     void select( uint8_t rom[8]);
@@ -121,17 +125,17 @@ class OneWire
 
     // Write a bit. The bus is always left powered at the end, see
     // note in write() about that.
-    void write_bit(uint8_t v);
+    virtual void write_bit(uint8_t v);
 
     // Read a bit.
-    uint8_t read_bit(void);
+    virtual uint8_t read_bit(void);
 
     // Stop forcing power onto the bus. You only need to do this if
     // you used the 'power' flag to write() or used a write_bit() call
     // and aren't about to do another read or write. You would rather
     // not leave this powered if you don't have to, just in case
     // someone shorts your bus.
-    void depower(void);
+    virtual void depower(void);
 
 #if ONEWIRE_SEARCH
     // Clear the search state so that if will start from the beginning again.
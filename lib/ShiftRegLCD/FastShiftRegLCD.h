@@ -0,0 +1,46 @@
+// FastShiftRegLCD - ShiftRegLCD with the pins fixed at compile time
+//
+// Same wiring and interface as ShiftRegLCD, but the data, clock and enable
+// pins are template arguments driven through FastPin, so shifting a byte
+// out is a few sbi/cbi per bit instead of digitalWrite() calls.
+//
+// USAGE: FastShiftRegLCD<Datapin, Clockpin, Enablepin or TWO_WIRE> LCDobjectvariablename(Lines [, Font])
+//        LCDobjectvariablename.begin() in setup(), before anything is printed.
+//   Unlike ShiftRegLCD the constructor leaves the display alone, the
+//   initialization and its 50ms power-on wait run in begin(), when the
+//   sketch has time for them.
+//
+// Needs #include <FastPin.h> in the sketch as well.
+
+#ifndef FastShiftRegLCD_h
+#define FastShiftRegLCD_h
+
+#include "ShiftRegLCD.h"
+#include <FastPin.h>
+
+template <uint8_t SRDATA, uint8_t SRCLOCK, uint8_t ENABLE>
+class FastShiftRegLCD : public ShiftRegLCD {
+public:
+  FastShiftRegLCD(uint8_t lines) : _lines(lines), _font(0) { }
+  FastShiftRegLCD(uint8_t lines, uint8_t font) : _lines(lines), _font(font) { }
+  void begin() { init(SRDATA, SRCLOCK, ENABLE, _lines, _font); }
+protected:
+  virtual void shiftByte(uint8_t value) {
+    for (uint8_t bit = 0x80; bit; bit >>= 1) {
+      Data::set(value & bit);
+      Clock::high();
+      Clock::low();
+    }
+  }
+  virtual void setEnable(uint8_t level) {
+    Enable::set(level);
+  }
+private:
+  typedef FastPin<SRDATA> Data;
+  typedef FastPin<SRCLOCK> Clock;
+  typedef FastPin<ENABLE == TWO_WIRE ? SRDATA : ENABLE> Enable;
+  uint8_t _lines;
+  uint8_t _font;
+};
+
+#endif
@@ -62,6 +62,9 @@ ShiftRegLCD::ShiftRegLCD(uint8_t srdata, uint8_t srclock, uint8_t enable, uint8_
 ShiftRegLCD::ShiftRegLCD(uint8_t srdata, uint8_t srclock, uint8_t enable, uint8_t lines, uint8_t font) {
 	init(srdata, srclock, enable, lines, font);
 }
+// For subclasses, which call init() once they can take over the pins
+ShiftRegLCD::ShiftRegLCD() {
+}
 
 
 void ShiftRegLCD::init(uint8_t srdata, uint8_t srclock, uint8_t enable, uint8_t lines, uint8_t font)
@@ -231,32 +234,41 @@ size_t ShiftRegLCD::write(uint8_t value) {
 // For sending data via the shiftregister
 void ShiftRegLCD::send(uint8_t value, uint8_t mode) {
   uint8_t val1, val2;
-  if ( _two_wire ) shiftOut ( _srdata_pin, _srclock_pin, MSBFIRST, 0x00 ); // clear shiftregister
-  digitalWrite( _enable_pin, LOW );
+  if ( _two_wire ) shiftByte( 0x00 ); // clear shiftregister
+  setEnable( LOW );
   mode = mode ? SR_RS_BIT : 0; // RS bit; LOW: command.  HIGH: character.
   val1 = mode | SR_EN_BIT | ((value >> 1) & 0x78); // upper nibble
   val2 = mode | SR_EN_BIT | ((value << 3) & 0x78); // lower nibble
-  shiftOut ( _srdata_pin, _srclock_pin, MSBFIRST, val1 );
-  digitalWrite( _enable_pin, HIGH );
+  shiftByte( val1 );
+  setEnable( HIGH );
   delayMicroseconds(1);                 // enable pulse must be >450ns
-  digitalWrite( _enable_pin, LOW );
-  if ( _two_wire ) shiftOut ( _srdata_pin, _srclock_pin, MSBFIRST, 0x00 ); // clear shiftregister
-  shiftOut ( _srdata_pin, _srclock_pin, MSBFIRST, val2 );
-  digitalWrite( _enable_pin, HIGH );
+  setEnable( LOW );
+  if ( _two_wire ) shiftByte( 0x00 ); // clear shiftregister
+  shiftByte( val2 );
+  setEnable( HIGH );
   delayMicroseconds(1);                 // enable pulse must be >450ns
-  digitalWrite( _enable_pin, LOW );
+  setEnable( LOW );
   delayMicroseconds(40);               // commands need > 37us to settle
 }
 
 // For sending data when initializing the display to 4-bit
 void ShiftRegLCD::init4bits(uint8_t value) {
   uint8_t val1;
-  if ( _two_wire ) shiftOut ( _srdata_pin, _srclock_pin, MSBFIRST, 0x00 ); // clear shiftregister
-  digitalWrite( _enable_pin, LOW );
+  if ( _two_wire ) shiftByte( 0x00 ); // clear shiftregister
+  setEnable( LOW );
   val1 = SR_EN_BIT | ((value >> 1) & 0x78);
-  shiftOut ( _srdata_pin, _srclock_pin, MSBFIRST, val1 );
-  digitalWrite( _enable_pin, HIGH );
+  shiftByte( val1 );
+  setEnable( HIGH );
   delayMicroseconds(1);                 // enable pulse must be >450ns
-  digitalWrite( _enable_pin, LOW );
+  setEnable( LOW );
   delayMicroseconds(40);               // commands need > 37us to settle
 }
+
+// Pin access, overridden by FastShiftRegLCD
+void ShiftRegLCD::shiftByte(uint8_t value) {
+  shiftOut ( _srdata_pin, _srclock_pin, MSBFIRST, value );
+}
+
+void ShiftRegLCD::setEnable(uint8_t level) {
+  digitalWrite( _enable_pin, level );
+}
@@ -75,8 +75,12 @@ public:
   void setCursor(uint8_t, uint8_t);
   virtual size_t write(uint8_t);
   void command(uint8_t);
-private:
+protected:
+  ShiftRegLCD();
   void init(uint8_t srdata, uint8_t srclock, uint8_t enable, uint8_t lines, uint8_t font);
+  virtual void shiftByte(uint8_t);
+  virtual void setEnable(uint8_t);
+private:
   void send(uint8_t, uint8_t);
   void init4bits(uint8_t);
   uint8_t _srdata_pin;
@@ -0,0 +1,168 @@
+/*
+ * TimeConversionCheck.pde
+ * example code checking breakTime() and makeTime() against the original
+ * loop based conversions, and timing both.
+ *
+ * Every day from 1 Jan 1970 till the end of the time_t range (7 Feb 2106)
+ * is broken into elements by both versions at a few times of day, the
+ * elements are compared and assembled back with makeTime().
+ * The full run takes about a minute, most of it in the reference code.
+ */
+
+#include <Time.h>
+
+#define CHECKS_PER_DAY 4
+const unsigned long checkSeconds[CHECKS_PER_DAY] = { 0, 1, 43210, 86399 };
+
+#define BENCH_RUNS 200
+
+// the original conversions, kept here as the reference
+#define LEAP_YEAR(Y)     ( ((1970+Y)>0) && !((1970+Y)%4) && ( ((1970+Y)%100) || !((1970+Y)%400) ) )
+
+static const uint8_t monthDays[] = {31,28,31,30,31,30,31,31,30,31,30,31};
+
+void referenceBreakTime(time_t time, tmElements_t &tm){
+  uint8_t year;
+  uint8_t month, monthLength;
+  unsigned long days;
+
+  tm.Second = time % 60;
+  time /= 60; // now it is minutes
+  tm.Minute = time % 60;
+  time /= 60; // now it is hours
+  tm.Hour = time % 24;
+  time /= 24; // now it is days
+  tm.Wday = ((time + 4) % 7) + 1;  // Sunday is day 1
+
+  year = 0;
+  days = 0;
+  while((unsigned)(days += (LEAP_YEAR(year) ? 366 : 365)) <= time) {
+    year++;
+  }
+  tm.Year = year; // year is offset from 1970
+
+  days -= LEAP_YEAR(year) ? 366 : 365;
+  time  -= days; // now it is days in this year, starting at 0
+
+  for (month=0; month<12; month++) {
+    if (month==1) { // february
+      monthLength = LEAP_YEAR(year) ? 29 : 28;
+    } else {
+      monthLength = monthDays[month];
+    }
+    if (time >= monthLength) {
+      time -= monthLength;
+    } else {
+      break;
+    }
+  }
+  tm.Month = month + 1;  // jan is month 1
+  tm.Day = time + 1;     // day of month
+}
+
+time_t referenceMakeTime(tmElements_t &tm){
+  int i;
+  time_t seconds;
+
+  // seconds from 1970 till 1 jan 00:00:00 of the given year
+  seconds= tm.Year*(SECS_PER_DAY * 365);
+  for (i = 0; i < tm.Year; i++) {
+    if (LEAP_YEAR(i)) {
+      seconds +=  SECS_PER_DAY;   // add extra days for leap years
+    }
+  }
+  // add days for this year, months start from 1
+  for (i = 1; i < tm.Month; i++) {
+    if ( (i == 2) && LEAP_YEAR(tm.Year)) {
+      seconds += SECS_PER_DAY * 29;
+    } else {
+      seconds += SECS_PER_DAY * monthDays[i-1];  //monthDay array starts from 0
+    }
+  }
+  seconds+= (tm.Day-1) * SECS_PER_DAY;
+  seconds+= tm.Hour * SECS_PER_HOUR;
+  seconds+= tm.Minute * SECS_PER_MIN;
+  seconds+= tm.Second;
+  return seconds;
+}
+
+void setup()  {
+  Serial.begin(9600);
+  checkAll();
+  benchmark();
+}
+
+void loop(){
+}
+
+void checkAll(){
+  unsigned long errors = 0;
+  uint8_t lastYear = 255;
+
+  Serial.println("Checking conversions 1970-2106");
+  for (unsigned long day = 0; day <= 0xFFFFFFFFUL / SECS_PER_DAY; day++) {
+    for (uint8_t i = 0; i < CHECKS_PER_DAY; i++) {
+      time_t t = day * SECS_PER_DAY + checkSeconds[i];
+      if (t < day * SECS_PER_DAY)
+        break;  // past the end of the time_t range
+      tmElements_t expected, actual;
+      referenceBreakTime(t, expected);
+      breakTime(t, actual);
+      if (memcmp(&expected, &actual, sizeof(tmElements_t)) != 0 || makeTime(actual) != t) {
+        errors++;
+        Serial.print("Mismatch at ");
+        Serial.println(t);
+      }
+      if (expected.Year != lastYear) {
+        lastYear = expected.Year;
+        if (lastYear % 10 == 0) {
+          Serial.print(tmYearToCalendar(lastYear));
+          Serial.println("...");
+        }
+      }
+    }
+  }
+  Serial.print("Done, mismatches: ");
+  Serial.println(errors);
+}
+
+void benchmark(){
+  // the old loops get slower every year, so time them at both ends of the range
+  time_t samples[3] = { 86400UL * 10, 1356998400UL /* 2013 */, 0xFFFFFFFFUL - 86400UL };
+  for (uint8_t s = 0; s < 3; s++) {
+    tmElements_t tm;
+    time_t t = samples[s];
+    unsigned long start, oldBreak, newBreak, oldMake, newMake;
+    volatile time_t sink;
+
+    start = micros();
+    for (int i = 0; i < BENCH_RUNS; i++)
+      referenceBreakTime(t + i, tm);
+    oldBreak = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < BENCH_RUNS; i++)
+      breakTime(t + i, tm);
+    newBreak = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < BENCH_RUNS; i++)
+      sink = referenceMakeTime(tm);
+    oldMake = micros() - start;
+
+    start = micros();
+    for (int i = 0; i < BENCH_RUNS; i++)
+      sink = makeTime(tm);
+    newMake = micros() - start;
+
+    Serial.print(tmYearToCalendar(tm.Year));
+    Serial.print(" breakTime us: ");
+    Serial.print(oldBreak / BENCH_RUNS);
+    Serial.print(" -> ");
+    Serial.print(newBreak / BENCH_RUNS);
+    Serial.print("  makeTime us: ");
+    Serial.print(oldMake / BENCH_RUNS);
+    Serial.print(" -> ");
+    Serial.println(newMake / BENCH_RUNS);
+  }
+}
@@ -5,7 +5,8 @@
  */
 
 #include <Time.h>  
-#include <Wire.h>  
+#include <TwiAsync.h>  // the RTC libraries' bus, it owns the TWI: no Wire.h
+#include <DSRTC.h>
 #include <DS1307RTC.h>  // a basic DS1307 library that returns time as a time_t
 
 void setup()  {
@@ -19,6 +20,7 @@ void setup()  {
 
 void loop()
 {
+   TwiAsync.poll();  // runs the callbacks of finished transfers
    digitalClockDisplay();  
    delay(1000);
 }
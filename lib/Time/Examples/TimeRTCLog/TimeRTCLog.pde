@@ -7,7 +7,8 @@
  */
 
 #include <Time.h>  
-#include <Wire.h>  
+#include <TwiAsync.h>  // the RTC libraries' bus, it owns the TWI: no Wire.h
+#include <DSRTC.h>
 #include <DS1307RTC.h>  // a basic DS1307 library that returns time as a time_t
 
 const int nbrInputPins  = 6;             // monitor 6 digital pins 
@@ -27,6 +28,7 @@ void setup()  {
 
 void loop()
 {
+   TwiAsync.poll();  // runs the callbacks of finished transfers
    for(int i=0; i < nbrInputPins; i++)
    {
      boolean val = digitalRead(inputPins[i]); 
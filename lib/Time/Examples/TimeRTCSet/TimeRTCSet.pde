@@ -7,7 +7,8 @@
  */
 
 #include <Time.h>  
-#include <Wire.h>  
+#include <TwiAsync.h>  // the RTC libraries' bus, it owns the TWI: no Wire.h
+#include <DSRTC.h>
 #include <DS1307RTC.h>  // a basic DS1307 library that returns time as a time_t
 
 
@@ -22,6 +23,7 @@ void setup()  {
 
 void loop()
 {
+  TwiAsync.poll();  // runs the callbacks of finished transfers
   if(Serial.available())
   {
      time_t t = processSyncMessage();
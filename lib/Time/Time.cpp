@@ -33,8 +33,16 @@ static tmElements_t tm;          // a cache of time elements
 static time_t       cacheTime;   // the time the cache was updated
 static time_t       syncInterval = 300;  // time sync will be attempted after this many seconds
 
+static time_t sysTime = 0;
+static tmElements_t sysElements = {0, 0, 0, 5, 1, 1, 0};  // sysTime as calendar fields, 1 Jan 1970 was a Thursday
+
 void refreshCache( time_t t){
-  if( t != cacheTime)
+  if( t == sysTime)
+  {
+    tm = sysElements;  // already current, no need to break the time
+    cacheTime = t;
+  }
+  else if( t != cacheTime)
   {
     breakTime(t, tm); 
     cacheTime = t; 
@@ -42,7 +50,8 @@ void refreshCache( time_t t){
 }
 
 int hour() { // the hour now 
-  return hour(now()); 
+  now();
+  return sysElements.Hour; 
 }
 
 int hour(time_t t) { // the hour for the given time
@@ -81,7 +90,8 @@ uint8_t isPM(time_t t) { // returns true if PM
 }
 
 int minute() {
-  return minute(now()); 
+  now();
+  return sysElements.Minute; 
 }
 
 int minute(time_t t) { // the minute for the given time
@@ -90,7 +100,8 @@ int minute(time_t t) { // the minute for the given time
 }
 
 int second() {
-  return second(now()); 
+  now();
+  return sysElements.Second; 
 }
 
 int second(time_t t) {  // the second for the given time
@@ -99,7 +110,8 @@ int second(time_t t) {  // the second for the given time
 }
 
 int day(){
-  return(day(now())); 
+  now();
+  return sysElements.Day; 
 }
 
 int day(time_t t) { // the day for the given time (0-6)
@@ -108,7 +120,8 @@ int day(time_t t) { // the day for the given time (0-6)
 }
 
 int weekday() {   // Sunday is day 1
-  return  weekday(now()); 
+  now();
+  return sysElements.Wday; 
 }
 
 int weekday(time_t t) {
@@ -117,7 +130,8 @@ int weekday(time_t t) {
 }
    
 int month(){
-  return month(now()); 
+  now();
+  return sysElements.Month; 
 }
 
 int month(time_t t) {  // the month for the given time
@@ -126,7 +140,8 @@ int month(time_t t) {  // the month for the given time
 }
 
 int year() {  // as in Processing, the full four digit year: (2009, 2010 etc) 
-  return year(now()); 
+  now();
+  return tmYearToCalendar(sysElements.Year); 
 }
 
 int year(time_t t) { // the year for the given time
@@ -138,60 +153,42 @@ int year(time_t t) { // the year for the given time
 /* functions to convert to and from system time */
 /* These are for interfacing with time serivces and are not normally needed in a sketch */
 
-// leap year calulator expects year argument as years offset from 1970
-#define LEAP_YEAR(Y)     ( ((1970+Y)>0) && !((1970+Y)%4) && ( ((1970+Y)%100) || !((1970+Y)%400) ) )
+// The conversions below count days from 1 March 1968, the start of a four year
+// leap cycle. With March as the first month the leap day is the last day of
+// the year, so both directions are plain arithmetic with no loop over the
+// years or months. 2100 is the only year in the time_t range that breaks the
+// four year rule; the 29th of February it would have is skipped explicitly.
+#define DAYS_TO_1970      671    // 1 Mar 1968 till 1 Jan 1970
+#define DAYS_TO_MAR_2100  48212  // 1 Mar 1968 till 1 Mar 2100
+#define DAYS_PER_CYCLE    1461   // days in four years, one of them leap
 
-static  const uint8_t monthDays[]={31,28,31,30,31,30,31,31,30,31,30,31}; // API starts months from 1, this array starts from 0
- 
 void breakTime(time_t time, tmElements_t &tm){
 // break the given time_t into time components
 // this is a more compact version of the C library localtime function
 // note that year is offset from 1970 !!!
 
-  uint8_t year;
-  uint8_t month, monthLength;
-  unsigned long days;
+  unsigned long minutes = time / 60;
+  uint16_t days = minutes / (24 * 60UL);
+  uint16_t minOfDay = minutes - days * (24 * 60UL);
   
-  tm.Second = time % 60;
-  time /= 60; // now it is minutes
-  tm.Minute = time % 60;
-  time /= 60; // now it is hours
-  tm.Hour = time % 24;
-  time /= 24; // now it is days
-  tm.Wday = ((time + 4) % 7) + 1;  // Sunday is day 1 
+  tm.Second = time - minutes * 60;
+  tm.Hour = minOfDay / 60;
+  tm.Minute = minOfDay - tm.Hour * 60;
+  tm.Wday = ((days + 4) % 7) + 1;  // Sunday is day 1 
   
-  year = 0;  
-  days = 0;
-  while((unsigned)(days += (LEAP_YEAR(year) ? 366 : 365)) <= time) {
-    year++;
-  }
-  tm.Year = year; // year is offset from 1970 
+  days += DAYS_TO_1970;
+  if (days >= DAYS_TO_MAR_2100)
+    days++;  // step over the 29th of February 2100 the leap cycle assumes
   
-  days -= LEAP_YEAR(year) ? 366 : 365;
-  time  -= days; // now it is days in this year, starting at 0
+  uint16_t cycle = days / DAYS_PER_CYCLE;
+  uint16_t dayOfCycle = days - cycle * DAYS_PER_CYCLE;
+  uint8_t  yearOfCycle = (dayOfCycle - dayOfCycle / (DAYS_PER_CYCLE - 1)) / 365;  // 0-3, the leap day stays in year 3
+  uint16_t dayOfYear = dayOfCycle - yearOfCycle * 365;  // 0 is the 1st of March
+  uint8_t  month = (5 * dayOfYear + 2) / 153;           // 0 is March, 11 is February
   
-  days=0;
-  month=0;
-  monthLength=0;
-  for (month=0; month<12; month++) {
-    if (month==1) { // february
-      if (LEAP_YEAR(year)) {
-        monthLength=29;
-      } else {
-        monthLength=28;
-      }
-    } else {
-      monthLength = monthDays[month];
-    }
-    
-    if (time >= monthLength) {
-      time -= monthLength;
-    } else {
-        break;
-    }
-  }
-  tm.Month = month + 1;  // jan is month 1  
-  tm.Day = time + 1;     // day of month
+  tm.Day = dayOfYear - (153 * month + 2) / 5 + 1;   // day of month
+  tm.Month = month < 10 ? month + 3 : month - 9;    // jan is month 1  
+  tm.Year = 4 * cycle + yearOfCycle + (tm.Month <= 2) - 2;  // year is offset from 1970 
 }
 
 time_t makeTime(tmElements_t &tm){   
@@ -199,37 +196,36 @@ time_t makeTime(tmElements_t &tm){
 // note year argument is offset from 1970 (see macros in time.h to convert to other formats)
 // previous version used full four digit year (or digits since 2000),i.e. 2009 was 2009 or 9
   
-  int i;
-  time_t seconds;
-
-  // seconds from 1970 till 1 jan 00:00:00 of the given year
-  seconds= tm.Year*(SECS_PER_DAY * 365);
-  for (i = 0; i < tm.Year; i++) {
-    if (LEAP_YEAR(i)) {
-      seconds +=  SECS_PER_DAY;   // add extra days for leap years
-    }
+  uint16_t year = tm.Year + 2;  // years since 1968
+  uint8_t  month = tm.Month;
+  uint16_t days;
+
+  // January and February count as months 13 and 14 of the previous year
+  if (month <= 2) {
+    year--;
+    month += 12;
   }
+  days = year * 365 + year / 4 + (153 * (month - 3) + 2) / 5 + tm.Day - 1;
+  if (days >= DAYS_TO_MAR_2100 + 1)
+    days--;  // no 29th of February in 2100
+  days -= DAYS_TO_1970;
   
-  // add days for this year, months start from 1
-  for (i = 1; i < tm.Month; i++) {
-    if ( (i == 2) && LEAP_YEAR(tm.Year)) { 
-      seconds += SECS_PER_DAY * 29;
-    } else {
-      seconds += SECS_PER_DAY * monthDays[i-1];  //monthDay array starts from 0
-    }
-  }
-  seconds+= (tm.Day-1) * SECS_PER_DAY;
-  seconds+= tm.Hour * SECS_PER_HOUR;
-  seconds+= tm.Minute * SECS_PER_MIN;
-  seconds+= tm.Second;
-  return seconds; 
+  return ((days * 24UL + tm.Hour) * 60 + tm.Minute) * 60 + tm.Second;
 }
 /*=====================================================*/	
 /* Low level system time functions  */
 
-static time_t sysTime = 0;
 static time_t prevMillis = 0;
 static time_t nextSyncTime = 0;
+static volatile uint8_t *tickSource = 0;  // external seconds counter, 0 to count with millis()
+static uint8_t lastTicks;
+static uint8_t tickRunning = false;
+
+#define TICK_TIMEOUT 2000  // ms without a tick before the external timebase is considered stopped
+
+static long slewMs = 0;    // offset still to be applied by shorter or longer seconds
+#define SLEW_RATE   10     // ms a second may be shortened or stretched by
+#define SLEW_LIMIT  2      // s, a sync closer than this is slewed instead of stepped
 static timeStatus_t Status = timeNotSet;
 
 getExternalTime getTimePtr;  // pointer to external sync function
@@ -240,23 +236,127 @@ time_t sysUnsyncedTime = 0; // the time sysTime unadjusted by sync
 #endif
 
 
-time_t now(){
-  while( millis() - prevMillis >= 1000){      
-    sysTime++;
-    prevMillis += 1000;	
+// leap year calculator expects year argument as years offset from 1970,
+// 2100 is the only year in the time_t range where the four year rule fails
+#define LEAP_YEAR(Y)     ( (((Y) & 3) == 2) && ((Y) != 130) )
+
+static  const uint8_t monthDays[]={31,28,31,30,31,30,31,31,30,31,30,31}; // API starts months from 1, this array starts from 0
+
+static void tickElements(tmElements_t &tm){
+// advance tm by one second, carrying into the larger fields
+  if (++tm.Second < 60)
+    return;
+  tm.Second = 0;
+  if (++tm.Minute < 60)
+    return;
+  tm.Minute = 0;
+  if (++tm.Hour < 24)
+    return;
+  tm.Hour = 0;
+  if (++tm.Wday > 7)
+    tm.Wday = 1;
+  uint8_t monthLength = monthDays[tm.Month - 1];
+  if (tm.Month == 2 && LEAP_YEAR(tm.Year))
+    monthLength++;
+  if (++tm.Day <= monthLength)
+    return;
+  tm.Day = 1;
+  if (++tm.Month <= 12)
+    return;
+  tm.Month = 1;
+  tm.Year++;
+}
+
+#define STEP_LIMIT 60  // s, stepElements() breaks the time afresh past this
+
+void stepElements(time_t t, tmElements_t &tm, time_t &tmTime){
+// bring tm, the elements of tmTime, to t: a few seconds on are stepped
+// like the system time's own elements, anything else is broken afresh
+  if(tmTime != 0 && t >= tmTime && t - tmTime <= STEP_LIMIT){
+    while(tmTime != t){
+      tickElements(tm);
+      tmTime++;
+    }
+  }
+  else if(t != tmTime){
+    breakTime(t, tm);
+    tmTime = t;
+  }
+}
+
+static void tickSecond(){
+  sysTime++;
+  tickElements(sysElements);
 #ifdef TIME_DRIFT_INFO
-    sysUnsyncedTime++; // this can be compared to the synced time to measure long term drift     
+  sysUnsyncedTime++; // this can be compared to the synced time to measure long term drift     
 #endif	
+}
+
+static void syncTime(){
+  if(getTimePtr != 0){
+    uint8_t ticks = tickSource != 0 ? *tickSource : 0;
+    time_t t = getTimePtr();
+    if(tickSource != 0 && *tickSource != ticks)
+      t = getTimePtr();  // a second started during the read, read again right after it
+    long diff = t - sysTime;
+    if( t != 0 && Status != timeNotSet && diff >= -SLEW_LIMIT && diff <= SLEW_LIMIT){
+      // close: no jump. A provider counting whole seconds only tells the
+      // offset to within a second, go half way and let the next syncs settle it
+      if(slewMs == 0)
+        slewMs = diff * 500;
+      nextSyncTime = sysTime + syncInterval;
+      Status = timeSet;
+    }
+    else if( t != 0)
+      setTime(t);
+    else
+      Status = (Status == timeNotSet) ?  timeNotSet : timeNeedsSync;        
   }
-  if(nextSyncTime <= sysTime){
-	if(getTimePtr != 0){
-	  time_t t = getTimePtr();
-      if( t != 0)
-        setTime(t);
-      else
-        Status = (Status == timeNotSet) ?  timeNotSet : timeNeedsSync;        
+}
+
+time_t now(){
+  if(tickSource != 0){
+    uint8_t ticks = *tickSource;  // a byte is read atomically
+    if(tickRunning){
+      if(ticks != lastTicks){
+        do {
+          tickSecond();
+        } while(++lastTicks != ticks);
+        // the seconds come from outside: only whole seconds can be slewed
+        if(slewMs >= 500 || slewMs <= -500){
+          adjustTime(slewMs > 0 ? 1 : -1);
+          slewMs -= slewMs > 0 ? 1000 : -1000;
+        }
+        else
+          slewMs = 0;
+        prevMillis = millis();
+        if(Status != timeSet)
+          syncTime();  // a provider reading in the background returns 0 at first, poll once a tick until it answers
+        return sysTime;  // counted by the external timebase, no periodic sync needed
+      }
+      if(millis() - prevMillis < TICK_TIMEOUT)
+        return sysTime;
+      // no tick for too long: count with millis() from the last tick and sync as usual
+      tickRunning = false;
+      nextSyncTime = sysTime;
+    }
+    else if(ticks != lastTicks){
+      // ticking (again), the count is in doubt until the clock is read once
+      tickRunning = true;
+      syncTime();
+      return sysTime;
     }
-  }  
+  }
+  for(;;){
+    int step = slewMs > SLEW_RATE ? SLEW_RATE : (slewMs < -SLEW_RATE ? -SLEW_RATE : slewMs);
+    if(millis() - prevMillis < (unsigned long)(1000 - step))
+      break;
+    tickSecond();
+    prevMillis += 1000 - step;	
+    slewMs -= step;
+  }
+  if(nextSyncTime <= sysTime)
+    syncTime();
   return sysTime;
 }
 
@@ -267,29 +367,35 @@ void setTime(time_t t){
 #endif
 
   sysTime = t;  
+  slewMs = 0;
+  breakTime(sysTime, sysElements);
   nextSyncTime = t + syncInterval;
   Status = timeSet; 
   prevMillis = millis();  // restart counting from now (thanks to Korman for this fix)
+  if(tickSource != 0)
+    lastTicks = *tickSource;
 } 
 
 void  setTime(int hr,int min,int sec,int dy, int mnth, int yr){
  // year can be given as full four digit year or two digts (2010 or 10 for 2010);  
  //it is converted to years since 1970
+  tmElements_t elements;
   if( yr > 99)
       yr = yr - 1970;
   else
       yr += 30;  
-  tm.Year = yr;
-  tm.Month = mnth;
-  tm.Day = dy;
-  tm.Hour = hr;
-  tm.Minute = min;
-  tm.Second = sec;
-  setTime(makeTime(tm));
+  elements.Year = yr;
+  elements.Month = mnth;
+  elements.Day = dy;
+  elements.Hour = hr;
+  elements.Minute = min;
+  elements.Second = sec;
+  setTime(makeTime(elements));
 }
 
 void adjustTime(long adjustment){
   sysTime += adjustment;
+  breakTime(sysTime, sysElements);
 }
 
 timeStatus_t timeStatus(){ // indicates if time has been set and recently synchronized
@@ -304,4 +410,25 @@ void setSyncProvider( getExternalTime getTimeFunction){
 
 void setSyncInterval(time_t interval){ // set the number of seconds between re-sync
   syncInterval = interval;
-}
\ No newline at end of file
+}
+
+void setTickSource(volatile uint8_t *ticks){ // count seconds from an external 1Hz counter, 0 goes back to millis()
+  tickSource = ticks;
+  tickRunning = false;  // trusted after the first tick and a sync
+  if(ticks != 0)
+    lastTicks = *ticks;
+  prevMillis = millis();
+}
+
+void slewTime(long ms){ // apply an offset gradually, by seconds at most SLEW_RATE ms shorter or longer
+  slewMs += ms;
+}
+
+long slewRemaining(){ // the part of the offset not applied yet
+  return slewMs;
+}
+
+int millisecond(){ // milliseconds into the current second
+  unsigned long ms = millis() - prevMillis;
+  return ms > 999 ? 999 : ms;
+}
@@ -104,6 +104,9 @@ time_t now();              // return the current time as seconds since Jan 1 197
 void    setTime(time_t t);
 void    setTime(int hr,int min,int sec,int day, int month, int yr);
 void    adjustTime(long adjustment);
+void    slewTime(long ms);   // adjust by ms gradually, without jumps
+long    slewRemaining();     // ms of the slew still to be applied
+int     millisecond();       // milliseconds into the current second
 
 /* date strings */ 
 #define dt_MAX_STRING_LEN 9 // length of longest date string (excluding terminating null)
@@ -116,9 +119,11 @@ char* dayShortStr(uint8_t day);
 timeStatus_t timeStatus(); // indicates if time has been set and recently synchronized
 void    setSyncProvider( getExternalTime getTimeFunction); // identify the external time provider
 void    setSyncInterval(time_t interval); // set the number of seconds between re-sync
+void    setTickSource(volatile uint8_t *ticks); // count seconds from a counter bumped by a 1Hz interrupt instead of millis()
 
 /* low level functions to convert to and from system time                     */
 void breakTime(time_t time, tmElements_t &tm);  // break time_t into elements
+void stepElements(time_t t, tmElements_t &tm, time_t &tmTime);  // like breakTime, stepping on from tm, the elements of tmTime, when t is a little later
 time_t makeTime(tmElements_t &tm);  // convert time elements into time_t
 
 
@@ -0,0 +1,175 @@
+/*
+ * TimerWheel.cpp - any number of software timers on the MsTimer2 1ms tick
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <MsTimer2.h>
+#include "TimerWheel.h"
+
+#define SLOT_MASK  (TIMER_WHEEL_SLOTS - 1)
+
+// timer state bits
+#define ARMED      0x01  // in a slot
+#define PENDING    0x02  // on the fired list
+#define DROPPED    0x04  // the pending callback was cancelled
+#define FIRING     0x08  // on this tick's TIMER_ISR chain, not called yet
+
+Timer *TimerWheelClass::slots[TIMER_WHEEL_SLOTS];
+Timer * volatile TimerWheelClass::firedHead;
+volatile uint8_t TimerWheelClass::cursor;
+volatile unsigned long TimerWheelClass::tickCount;
+
+void TimerWheelClass::begin()
+{
+  MsTimer2::set(1, _tick);
+  MsTimer2::start();
+}
+
+// (Re)start t to fire in ms and, with TIMER_PERIODIC, every ms after.
+// A callback still pending from before is dropped, also one due in the
+// tick this is called from
+void TimerWheelClass::start(Timer &t, unsigned int ms, TimerCallback callback, uint8_t flags)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  if (t.state & ARMED)
+    unlink(t);
+  if (t.state & PENDING)
+    t.state |= DROPPED;
+  t.state &= ~FIRING;
+  t.period = ms;
+  t.callback = callback;
+  t.flags = flags;
+  insert(t, ms);
+  t.state |= ARMED;
+  SREG = oldSREG;
+}
+
+// Stop t, a callback it has pending won't be called. Neither will a
+// TIMER_ISR one due in the same tick, when cancelled from another's callback
+void TimerWheelClass::cancel(Timer &t)
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  if (t.state & ARMED)
+    unlink(t);
+  t.state &= ~(ARMED | FIRING);
+  if (t.state & PENDING)
+    t.state |= DROPPED;
+  SREG = oldSREG;
+}
+
+bool TimerWheelClass::active(Timer &t)
+{
+  return t.state & ARMED;
+}
+
+// Call the callbacks of the timers that fired since the last call
+void TimerWheelClass::run()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  Timer *fired = firedHead;
+  firedHead = 0;
+  SREG = oldSREG;
+  
+  while (fired != 0) {
+    Timer *t = fired;
+    cli();
+    fired = t->nextFired;
+    uint8_t state = t->state;
+    t->state = state & ARMED;
+    SREG = oldSREG;
+    if (!(state & DROPPED))
+      t->callback();
+  }
+}
+
+// ms since begin()
+unsigned long TimerWheelClass::ticks()
+{
+  uint8_t oldSREG = SREG;
+  cli();
+  unsigned long t = tickCount;
+  SREG = oldSREG;
+  return t;
+}
+
+// PRIVATE FUNCTIONS, called with interrupts off
+
+void TimerWheelClass::insert(Timer &t, unsigned int ms)
+{
+  if (ms == 0)
+    ms = 1;
+  // the current slot has been done, the next one is a tick away
+  t.slot = (cursor + ms) & SLOT_MASK;
+  t.turns = (ms - 1) / TIMER_WHEEL_SLOTS;
+  t.prev = 0;
+  t.next = slots[t.slot];
+  if (t.next != 0)
+    t.next->prev = &t;
+  slots[t.slot] = &t;
+}
+
+void TimerWheelClass::unlink(Timer &t)
+{
+  if (t.prev != 0)
+    t.prev->next = t.next;
+  else
+    slots[t.slot] = t.next;
+  if (t.next != 0)
+    t.next->prev = t.prev;
+}
+
+void TimerWheelClass::_tick()
+{
+  Timer *now = 0;  // TIMER_ISR timers due, called once the slot is done.
+                   // Chained through nextIsr: one restarted as TIMER_ISR
+                   // may still be on the fired list
+  
+  tickCount++;
+  cursor = (cursor + 1) & SLOT_MASK;
+  
+  Timer *t = slots[cursor];
+  while (t != 0) {
+    Timer *next = t->next;
+    if (t->turns > 0) {
+      t->turns--;
+    }
+    else {
+      unlink(*t);
+      if (t->flags & TIMER_PERIODIC)
+        insert(*t, t->period);  // from its due tick, lateness of run() doesn't add up
+      else
+        t->state &= ~ARMED;
+        
+      if (t->flags & TIMER_ISR) {
+        t->state |= FIRING;
+        t->nextIsr = now;
+        now = t;
+      }
+      else if (t->state & PENDING) {
+        t->state &= ~DROPPED;  // fired again before run(), the calls coalesce
+      }
+      else {
+        t->state |= PENDING;
+        t->nextFired = firedHead;
+        firedHead = t;
+      }
+    }
+    t = next;
+  }
+  
+  // the callbacks may start and cancel timers, also ones still on the chain
+  while (now != 0) {
+    t = now;
+    now = t->nextIsr;
+    if (t->state & FIRING) {
+      t->state &= ~FIRING;
+      t->callback();
+    }
+  }
+}
+
+TimerWheelClass TimerWheel;
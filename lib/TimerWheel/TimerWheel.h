@@ -0,0 +1,68 @@
+/*
+ * TimerWheel.h - any number of software timers on the MsTimer2 1ms tick
+ *
+ * Timers live in a hashed wheel of TIMER_WHEEL_SLOTS lists, a timer due in
+ * d ticks goes to slot (now + d) % slots with d / slots full turns to wait,
+ * so starting and cancelling is O(1) and a tick only looks at one slot.
+ * The tick only marks timers as fired; run(), called from loop(), calls
+ * their callbacks. A TIMER_ISR timer's callback runs in the tick itself
+ * instead, for a few cycles of work like toggling a pin.
+ *
+ * Timers are owned by the caller, typically static, and must not move
+ * while started.
+ *
+ * Owns Timer2 through MsTimer2: tone() and other MsTimer2 users can't run
+ * alongside.
+ */
+
+#ifndef TimerWheel_h
+#define TimerWheel_h
+
+#include <inttypes.h>
+
+#define TIMER_WHEEL_SLOTS  16  // power of 2
+
+// flags
+#define TIMER_PERIODIC  0x01  // restart when it fires, without drift
+#define TIMER_ISR       0x02  // callback runs in the tick, keep it short
+
+typedef void (*TimerCallback)();
+
+struct Timer {
+  Timer *next;             // slot list, owned by TimerWheel
+  Timer *prev;
+  Timer *nextFired;        // waiting for run()
+  Timer *nextIsr;          // TIMER_ISR timers due in this tick, apart from nextFired
+  unsigned int period;     // ms
+  unsigned int turns;      // full turns of the wheel left
+  TimerCallback callback;
+  uint8_t flags;
+  uint8_t slot;
+  volatile uint8_t state;  // owned by TimerWheel
+};
+
+class TimerWheelClass
+{
+  public:
+    static void begin();
+    static void start(Timer &t, unsigned int ms, TimerCallback callback, uint8_t flags);
+    static void cancel(Timer &t);
+    static bool active(Timer &t);
+    static void run();
+    static unsigned long ticks();
+    
+    static void _tick();
+
+  private:
+    static void insert(Timer &t, unsigned int ms);
+    static void unlink(Timer &t);
+    
+    static Timer *slots[TIMER_WHEEL_SLOTS];
+    static Timer * volatile firedHead;
+    static volatile uint8_t cursor;
+    static volatile unsigned long tickCount;
+};
+
+extern TimerWheelClass TimerWheel;
+
+#endif
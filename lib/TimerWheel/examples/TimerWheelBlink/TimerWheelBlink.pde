@@ -0,0 +1,44 @@
+/*
+ * TimerWheelBlink.pde
+ * example code running several timers on one hardware timer.
+ *
+ * The LED on pin 13 blinks from a periodic timer called in the loop, a
+ * second periodic timer prints the uptime every 5 seconds, and a one-shot
+ * stops the blinking after 20 seconds.
+ */
+
+#include <MsTimer2.h>
+#include <TimerWheel.h>
+
+Timer blinkTimer;
+Timer reportTimer;
+Timer stopTimer;
+
+void blink() {
+  digitalWrite(13, !digitalRead(13));
+}
+
+void report() {
+  Serial.print("ticks: ");
+  Serial.println(TimerWheel.ticks());
+}
+
+void stopBlinking() {
+  TimerWheel.cancel(blinkTimer);
+  digitalWrite(13, LOW);
+  Serial.println("blinking stopped");
+}
+
+void setup() {
+  Serial.begin(9600);
+  pinMode(13, OUTPUT);
+  
+  TimerWheel.begin();
+  TimerWheel.start(blinkTimer, 250, blink, TIMER_PERIODIC);
+  TimerWheel.start(reportTimer, 5000, report, TIMER_PERIODIC);
+  TimerWheel.start(stopTimer, 20000, stopBlinking, 0);
+}
+
+void loop() {
+  TimerWheel.run();
+}
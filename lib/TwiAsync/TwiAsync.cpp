@@ -0,0 +1,203 @@
+/*
+ * TwiAsync.cpp - interrupt driven I2C master for the ATmega TWI
+ *
+ * The queue is a singly linked list of caller owned transactions, the head
+ * is on the bus. The TWI interrupt moves finished transactions to a second
+ * list that poll() empties, running the callbacks outside the interrupt.
+ */
+
+#if ARDUINO >= 100
+#include <Arduino.h>
+#else
+#include <WProgram.h>
+#endif
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+#include "TwiAsync.h"
+
+#define TWCR_BASE  (_BV(TWEN) | _BV(TWIE) | _BV(TWINT))
+
+TwiTransaction * volatile TwiAsyncClass::head;
+TwiTransaction * volatile TwiAsyncClass::tail;
+TwiTransaction * volatile TwiAsyncClass::doneHead;
+TwiTransaction * volatile TwiAsyncClass::doneTail;
+volatile uint8_t TwiAsyncClass::pos;
+volatile bool TwiAsyncClass::reading;
+volatile unsigned long TwiAsyncClass::startedAt;
+
+void TwiAsyncClass::begin()
+{
+  // internal pull-ups, the bus needs external ones for full speed
+  digitalWrite(SDA, HIGH);
+  digitalWrite(SCL, HIGH);
+  
+  TWSR &= ~(_BV(TWPS0) | _BV(TWPS1));
+  TWBR = ((F_CPU / TWI_ASYNC_FREQ) - 16) / 2;
+  TWCR = _BV(TWEN);
+}
+
+bool TwiAsyncClass::queue(TwiTransaction &t)
+{
+  if (t.status == TWI_PENDING)
+    return false;
+    
+  t.status = TWI_PENDING;
+  t.next = 0;
+  
+  uint8_t oldSREG = SREG;
+  cli();
+  if (head == 0) {
+    head = tail = &t;
+    start();
+  }
+  else {
+    tail->next = &t;
+    tail = &t;
+  }
+  SREG = oldSREG;
+  return true;
+}
+
+uint8_t TwiAsyncClass::wait(TwiTransaction &t)
+{
+  while (t.status == TWI_PENDING)
+    poll();
+  poll();  // out of the done list before the caller reuses it
+  return t.status;
+}
+
+void TwiAsyncClass::poll()
+{
+  TwiTransaction *done;
+  uint8_t oldSREG = SREG;
+  cli();
+  // a slave holding the bus never raises the interrupt again
+  if (head != 0 && millis() - startedAt > TWI_ASYNC_TIMEOUT) {
+    TWCR = 0;  // reset the TWI, releasing the lines
+    TWCR = _BV(TWEN);
+    finish(TWI_TIMEOUT);
+  }
+  done = doneHead;
+  doneHead = doneTail = 0;
+  SREG = oldSREG;
+  
+  while (done != 0) {
+    TwiTransaction *t = done;
+    done = t->next;
+    t->next = 0;  // the callback may queue it again
+    if (t->callback != 0)
+      t->callback(*t);
+  }
+}
+
+bool TwiAsyncClass::busy()
+{
+  return head != 0;
+}
+
+// PRIVATE FUNCTIONS, called with interrupts off
+
+void TwiAsyncClass::start()
+{
+  pos = 0;
+  reading = head->headerLen == 0 && head->txLen == 0 && head->rxLen != 0;
+  startedAt = millis();
+  TWCR = TWCR_BASE | _BV(TWSTA);
+}
+
+void TwiAsyncClass::finish(uint8_t status)
+{
+  TwiTransaction *t = head;
+  
+  head = t->next;
+  if (head == 0)
+    tail = 0;
+  
+  t->next = 0;
+  if (doneHead == 0)
+    doneHead = t;
+  else
+    doneTail->next = t;
+  doneTail = t;
+  t->status = status;
+  
+  if (head != 0) {
+    // stop, then start the next transaction right away
+    pos = 0;
+    reading = head->headerLen == 0 && head->txLen == 0 && head->rxLen != 0;
+    startedAt = millis();
+    TWCR = TWCR_BASE | _BV(TWSTO) | _BV(TWSTA);
+  }
+  else {
+    TWCR = _BV(TWEN) | _BV(TWINT) | _BV(TWSTO);
+  }
+}
+
+void TwiAsyncClass::_interrupt()
+{
+  TwiTransaction *t = head;
+  if (t == 0) {
+    TWCR = _BV(TWEN) | _BV(TWINT);
+    return;
+  }
+  
+  switch (TW_STATUS) {
+    case TW_START:
+    case TW_REP_START:
+      TWDR = (t->address << 1) | (reading ? TW_READ : TW_WRITE);
+      TWCR = TWCR_BASE;
+      break;
+      
+    // master transmitter
+    case TW_MT_SLA_ACK:
+    case TW_MT_DATA_ACK:
+      if (pos < t->headerLen) {
+        TWDR = t->header[pos++];
+        TWCR = TWCR_BASE;
+      }
+      else if (pos < t->headerLen + t->txLen) {
+        TWDR = t->txData[pos++ - t->headerLen];
+        TWCR = TWCR_BASE;
+      }
+      else if (t->rxLen != 0) {
+        pos = 0;
+        reading = true;
+        TWCR = TWCR_BASE | _BV(TWSTA);  // repeated start
+      }
+      else {
+        finish(TWI_DONE);
+      }
+      break;
+      
+    // master receiver, the last byte is not acknowledged
+    case TW_MR_SLA_ACK:
+      TWCR = TWCR_BASE | (t->rxLen > 1 ? _BV(TWEA) : 0);
+      break;
+    case TW_MR_DATA_ACK:
+      t->rxData[pos++] = TWDR;
+      TWCR = TWCR_BASE | (pos < t->rxLen - 1 ? _BV(TWEA) : 0);
+      break;
+    case TW_MR_DATA_NACK:
+      t->rxData[pos++] = TWDR;
+      finish(TWI_DONE);
+      break;
+      
+    case TW_MT_SLA_NACK:
+    case TW_MT_DATA_NACK:
+    case TW_MR_SLA_NACK:
+      finish(TWI_NACK);
+      break;
+      
+    default:  // bus error, lost arbitration
+      finish(TWI_ERROR);
+      break;
+  }
+}
+
+ISR(TWI_vect)
+{
+  TwiAsyncClass::_interrupt();
+}
+
+TwiAsyncClass TwiAsync = TwiAsyncClass();
@@ -0,0 +1,73 @@
+/*
+ * TwiAsync.h - interrupt driven I2C master for the ATmega TWI
+ *
+ * Transactions are queued with an optional completion callback and run one
+ * after another by the TWI interrupt, so the caller never waits for the bus.
+ * Callbacks run from poll(), which the sketch calls from loop().
+ *
+ * Owns the TWI interrupt: can't be used together with the Wire library.
+ */
+
+#ifndef TwiAsync_h
+#define TwiAsync_h
+
+#include <inttypes.h>
+
+#define TWI_ASYNC_FREQ     100000L
+#define TWI_ASYNC_TIMEOUT  20      // ms a transaction may hold the bus before it is aborted
+
+// transaction status
+#define TWI_IDLE     0  // never queued
+#define TWI_PENDING  1  // queued or on the bus
+#define TWI_DONE     2
+#define TWI_NACK     3  // address or data not acknowledged
+#define TWI_ERROR    4  // bus error or lost arbitration
+#define TWI_TIMEOUT  5  // aborted after TWI_ASYNC_TIMEOUT
+
+struct TwiTransaction;
+typedef void (*TwiCallback)(TwiTransaction &t);
+
+// One bus transaction: header and txData are written, then rxData is read
+// after a repeated start. Either part may be empty. The transaction and its
+// buffers must stay valid until the status leaves TWI_PENDING, and it may
+// only be queued again once its callback ran (or wait() returned).
+struct TwiTransaction {
+  uint8_t address;        // 7 bit device address
+  uint8_t header[2];      // register or memory address, sent before txData
+  uint8_t headerLen;
+  const uint8_t *txData;
+  uint8_t txLen;
+  uint8_t *rxData;
+  uint8_t rxLen;
+  volatile uint8_t status;
+  TwiCallback callback;   // run from poll() when done, may be 0
+  TwiTransaction *next;   // queue link, owned by TwiAsync
+};
+
+class TwiAsyncClass
+{
+  public:
+    static void begin();
+    static bool queue(TwiTransaction &t);   // false if t is still pending
+    static uint8_t wait(TwiTransaction &t); // block until t is done, returns its status
+    static void poll();                     // run completed callbacks, abort a stuck transfer
+    static bool busy();
+    
+    static void _interrupt();
+
+  private:
+    static void start();
+    static void finish(uint8_t status);
+    
+    static TwiTransaction * volatile head;  // on the bus
+    static TwiTransaction * volatile tail;
+    static TwiTransaction * volatile doneHead;  // waiting for poll()
+    static TwiTransaction * volatile doneTail;
+    static volatile uint8_t pos;
+    static volatile bool reading;
+    static volatile unsigned long startedAt;
+};
+
+extern TwiAsyncClass TwiAsync;
+
+#endif
@@ -0,0 +1,36 @@
+#include <TwiAsync.h>
+
+// Probe every I2C address in the background and print the ones that answer,
+// while loop() keeps blinking the LED on pin 13 without a hiccup
+
+TwiTransaction probe;
+uint8_t address = 1;
+
+void probeDone(TwiTransaction &t) {
+  if (t.status == TWI_DONE) {
+    Serial.print("Device at 0x");
+    Serial.println(t.address, HEX);
+  }
+  if (++address < 0x78) {
+    t.address = address;
+    TwiAsync.queue(t);
+  }
+  else {
+    Serial.println("Scan done");
+  }
+}
+
+void setup() {
+  Serial.begin(9600);
+  pinMode(13, OUTPUT);
+  TwiAsync.begin();
+  
+  probe.address = address;  // no header and no data: address only
+  probe.callback = probeDone;
+  TwiAsync.queue(probe);
+}
+
+void loop() {
+  TwiAsync.poll();
+  digitalWrite(13, (millis() / 250) & 1);
+}
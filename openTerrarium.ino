@@ -8,19 +8,28 @@ bugs:
 #define VERSION "0.1"
 
 #include <OneWire.h>
+#include <OneWirePin.h>
 #include <DallasTemperature.h>
 
 #include <Arduino.h>
-#include <Wire.h>
+#include <FastPin.h>
+#include <TwiAsync.h>
+#include <DSRTC.h>
 #include <Time.h>
 #include <DS1307RTC.h>  // a basic DS1307 library that returns time as a time_t
+#include <DS3231RTC.h>
+#include <I2CEEPROM.h>
+#include <DeltaCodec.h>
 
 #include <MsTimer2.h>
+#include <TimerWheel.h>
 
 #include "pitches.h"
 
 #include <EEPROM.h>
+#include <avr/eeprom.h>
 #include "Settings.h"
+#include "LogSink.h"
 #include "Constants.h"
 
 
@@ -31,9 +40,10 @@ static double tempC;
 
 struct GlobalStruct {
  unsigned long lastUserInteraction;
- unsigned long lastBgTask;
 } Global;
 
+static Timer backgroundTimer;
+
 
 //up .O...
 void (*upPressed)(boolean);
@@ -48,47 +58,52 @@ void (*enterPressed)(boolean);
 
 
 void setup() {
-//  Serial.begin(9600);  
-  Serial.begin(115200);
-  
-  Serial.print("Wellcome to HotReptile! ");
-  Serial.println(VERSION);
-  Serial.println();
-  
+//  LogSink.begin(9600);  
+  LogSink.begin(115200);
   
   //load settings
   Settings.loadConfig();
-  Serial.println();
+  
+  initWatchdog();
+  
+  TimerWheel.begin();
+  initSafety();
+  
+  startBoot();
   
   //setup time
-  setSyncProvider(RTC.get);
+  initClock();
+  syncMonoTime();
     
-  initTempSensor();
   //initRelay();
   initDimmer();
-  initLcd();
+  initBuzzer();
   initButtons();
-  
-  loadMainScreen();  
-  Serial.println();
-  
-  backgroundTasks();
-  
-   
-//  MsTimer2::set(TEMP_UPDATE_PERIOD, backgroundTasks); // temperature update period
-//  MsTimer2::start();
+  initCheckpoint();
   
   Global.lastUserInteraction = now();
-  
+  //the rest of the boot runs from the loop, see Boot
 }
 
 void loop() {
 
-  uiUpdate();  
+  if (booting()) {
+    watchdogMark(WATCHDOG_MARK_SETUP);
+    bootTasks();
+  }
+  else {
+    watchdogMark(WATCHDOG_MARK_UI);
+    uiUpdate();  
+  }
 
+  watchdogMark(WATCHDOG_MARK_FAST);
   fastBackgroundTasks();
   
-  backgroundTasks();
+  //backgroundTasks and the other timers' callbacks
+  watchdogMark(WATCHDOG_MARK_TIMERS);
+  TimerWheel.run();
+  
+  watchdogCheckIn(WATCHDOG_TASK_LOOP);
   
   //dimmerControl(3000);
   //delay(PROGRAM_SPEED);
@@ -96,28 +111,29 @@ void loop() {
 
 //can use LCD here
 void fastBackgroundTasks() {
-
+  safetyResync();
+  Settings.persistConfig();
+  TwiAsync.poll();
+  serialProtocol();
+  logDump();
+  persistHistory();
+  LogSink.pump();
 }
 
-//don't use LCD here!!
+//don't use LCD here!! runs every TEMP_UPDATE_PERIOD
 void backgroundTasks() {
-  //ensure that we update TEMP_UPDATE_PERIOD
-  if ((long)(millis() - Global.lastBgTask) < TEMP_UPDATE_PERIOD) {
-    return;
-  }
-  Global.lastBgTask = millis();
-  
-  Serial.print(year());Serial.print("/");
-  serialPrintDigits(month());Serial.print("/");
-  serialPrintDigits(day());Serial.print(" ");
-  serialPrintDigits(hour());Serial.print(":");
-  serialPrintDigits(minute());Serial.print(":");
-  serialPrintDigits(second());
-  
-    
-  
+  watchdogMark(WATCHDOG_MARK_CLOCK);
+  syncMonoTime();
+  checkStack();
   
+  watchdogMark(WATCHDOG_MARK_SENSOR);
   tempC = getTemperature();
+  validateSensor(tempC);
+  
+  watchdogMark(WATCHDOG_MARK_STORAGE);
+  saveCheckpoint();
+  logData(tempC);
+  historySample(tempC);
   
   //targetTemp for realay control. TODO handle better
 //  setTargetTemp(getSimulateClimateTemperature());
@@ -126,7 +142,10 @@ void backgroundTasks() {
 
   //controlTimedRelay(Settings.getRelayOnDayPercent());
   
-  Serial.println();
+  watchdogMark(WATCHDOG_MARK_TELEMETRY);
+  sendTelemetry();
+  
+  watchdogCheckIn(WATCHDOG_TASK_BACKGROUND);
 }
 
 
@@ -143,11 +162,11 @@ void uiUpdate() {
 
 
 
-void serialPrintDigits(int digits){
+void logPrintDigits(int digits){
   // utility function for digital clock display: prints preceding colon and leading 0
   if(digits < 10)
-    Serial.print('0');
-  Serial.print(digits);
+    LogSink.print('0');
+  LogSink.print(digits);
 }
 
 
@@ -172,18 +191,9 @@ int melody[] = { NOTE_G3 };
 int noteDurations[] = { 4 };
 
 void medody() {
-  // iterate over the notes of the melody:
-  for (int thisNote = 0; thisNote < 1; thisNote++) {
-
-    // to calculate the note duration, take one second 
-    // divided by the note type.
-    //e.g. quarter note = 1000 / 4, eighth note = 1000/8, etc.
-    int noteDuration = 1000/noteDurations[thisNote];
-    tone(BUZZER_PIN, melody[thisNote],noteDuration);
-
-    // to distinguish the notes, set a minimum time between them.
-    // the note's duration + 30% seems to work well:
-    int pauseBetweenNotes = noteDuration * 1.30;
-    delay(pauseBetweenNotes);
-  }
+  // a single note, played in the background so the control loop goes on.
+  // to calculate the note duration, take one second 
+  // divided by the note type.
+  //e.g. quarter note = 1000 / 4, eighth note = 1000/8, etc.
+  beep(melody[0], 1000/noteDurations[0]);
 }
@@ -0,0 +1,91 @@
+/*
+ * buzzer_test.cpp
+ * Plays beeps through the sketch's Buzzer.ino on lib/TimerWheel on the
+ * build machine, ticking the wheel by hand, and checks the pin toggles
+ * while a beep plays and is low once it is over. Durations that are a
+ * multiple of the half period are the case to watch: the stop and the
+ * last toggle are due in the same tick.
+ *
+ * tools/stub has the few AVR definitions TimerWheel needs, the pin is a
+ * variable here.
+ *
+ * Build: g++ -O1 -g -Itools/stub -Ilib/TimerWheel -Ilib/MsTimer2 -o buzzer_test \
+ *          tools/buzzer_test.cpp lib/TimerWheel/TimerWheel.cpp
+ * Usage: buzzer_test
+ *   prints a line per beep, exits 1 on any error
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <MsTimer2.h>
+#include "TimerWheel.h"
+
+uint8_t SREG;
+
+namespace MsTimer2 {
+  void set(unsigned long, void (*)()) {}
+  void start() {}
+}
+
+#define BUZZER_PIN 8
+
+template <uint8_t PIN> struct FastPin {
+  static uint8_t level;
+  static unsigned int toggles;
+  static void output() {}
+  static void low() { level = 0; }
+  static void toggle() { level ^= 1; toggles++; }
+};
+template <uint8_t PIN> uint8_t FastPin<PIN>::level;
+template <uint8_t PIN> unsigned int FastPin<PIN>::toggles;
+
+// the IDE generates these for the sketch
+void buzzerFlip();
+void buzzerOff();
+
+#include "../Buzzer.ino"
+
+static unsigned long errors;
+
+static void play(unsigned int frequency, unsigned int duration) {
+  BuzzerPin::toggles = 0;
+  beep(frequency, duration);
+  for (unsigned int ms = 0; ms < duration + 100; ms++) {
+    TimerWheel._tick();
+  }
+
+  unsigned int halfPeriod = frequency ? (500 + frequency / 2) / frequency : 0;
+  bool ok = BuzzerPin::level == 0 && (frequency == 0 || BuzzerPin::toggles > 0)
+      && !TimerWheel.active(buzzerToggle) && !TimerWheel.active(buzzerStop);
+  if (!ok) {
+    errors++;
+  }
+  printf("%4u Hz %4u ms, half period %2u: %3u toggles, pin %s %s\n", frequency, duration,
+         halfPeriod, BuzzerPin::toggles, BuzzerPin::level ? "high" : "low", ok ? "ok" : "FAILED");
+}
+
+int main() {
+  initBuzzer();
+
+  // medody()'s notes, a quarter second
+  play(52, 250);
+  play(208, 250);
+  // duration a multiple of the half period, and not
+  play(440, 250);
+  play(100, 250);
+  play(100, 252);
+  play(500, 7);
+  play(1000, 50);
+  play(0, 250);
+
+  // a beep replacing one that is still playing
+  beep(100, 1000);
+  for (int ms = 0; ms < 17; ms++) {
+    TimerWheel._tick();
+  }
+  play(52, 250);
+
+  printf("errors: %lu\n", errors);
+  return errors ? 1 : 0;
+}
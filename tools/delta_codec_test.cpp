@@ -0,0 +1,154 @@
+/*
+ * delta_codec_test.cpp
+ * Round trips series through lib/DeltaCodec on the build machine, the same
+ * checks as the DeltaCodecCheck example without a board.
+ *
+ * A day of minute readings in DS18B20 units (1/16*C) following a slow
+ * swing with a unit of jitter has to fit 13 blocks. Extremes, random
+ * values and a ramp of every difference check the wide codes and the 16
+ * bit wrap. Blocks of garbage must decode to at most their count without
+ * reading past the block, which the address sanitizer checks: each one is
+ * a separate allocation of exactly one block. An erased block, all 0xFF,
+ * is a run of continuation nibbles that must stop at 16 bits, which the
+ * undefined behaviour sanitizer checks.
+ *
+ * Build: g++ -O1 -g -fsanitize=address,undefined -fno-sanitize-recover=undefined \
+ *          -Ilib/DeltaCodec -o delta_codec_test \
+ *          tools/delta_codec_test.cpp lib/DeltaCodec/DeltaCodec.cpp
+ * Usage: delta_codec_test
+ *   prints a line per series, exits 1 on any error
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "DeltaCodec.h"
+
+#define DAY_SAMPLES 1440
+#define DAY_BLOCKS  13
+
+static uint8_t block[DELTA_BLOCK_SIZE];
+static unsigned long errors;
+
+static int daySample(int minute) {
+  return (int)(16 * (24 + 4 * sin(2 * M_PI * minute / DAY_SAMPLES))) + (minute * 7 % 3) - 1;
+}
+
+static int extremeSample(int i) {
+  static const int values[] = { 0, 32767, -32768, -32768, 32767, -1, 0, 1, -4, 3, -5, 4, -2032, 1360 };
+  return values[i % (sizeof(values) / sizeof(values[0]))];
+}
+
+static int randomSample(int) {
+  return (int16_t)(rand() & 0xffff);
+}
+
+// steps of every size up to the full 16 bit range, both ways
+static int rampSample(int i) {
+  return (int16_t)((long)i * i * 37);
+}
+
+// encode count samples of series into blocks, decode each block as it
+// fills and compare. Returns the number of blocks used
+static int roundTrip(const char *name, int (*series)(int), int count) {
+  DeltaEncoder encoder;
+  DeltaDecoder decoder;
+  int blocks = 0;
+  int i = 0;
+  int expected[DELTA_MAX_SAMPLES];
+  unsigned long before = errors;
+
+  while (i < count) {
+    int first = i;
+    expected[0] = series(i);
+    encoder.begin(block, i, expected[0]);
+    i++;
+    while (i < count) {
+      int v = series(i);
+      if (!encoder.add(v))
+        break;
+      expected[i - first] = v;
+      i++;
+    }
+    blocks++;
+
+    decoder.begin(block);
+    int v, n = 0;
+    while (decoder.next(v)) {
+      if (n >= i - first || v != expected[n]) {
+        errors++;
+        fprintf(stderr, "%s: mismatch at %d\n", name, first + n);
+      }
+      n++;
+    }
+    if (n != i - first || decoder.time() != (unsigned long)first) {
+      errors++;
+      fprintf(stderr, "%s: block at %d decoded %d of %d samples\n", name, first, n, i - first);
+    }
+  }
+  printf("%-8s %5d samples %4d blocks %6d bytes %s\n", name, count, blocks,
+         blocks * DELTA_BLOCK_SIZE, errors == before ? "ok" : "FAILED");
+  return blocks;
+}
+
+// a corrupt block must not make the decoder read past its end
+static void garbage(int rounds) {
+  unsigned long before = errors;
+  for (int r = 0; r < rounds; r++) {
+    uint8_t *copy = (uint8_t*)malloc(DELTA_BLOCK_SIZE);
+    for (int i = 0; i < DELTA_BLOCK_SIZE; i++) {
+      copy[i] = rand();
+    }
+    copy[4] = DELTA_MAX_SAMPLES;
+    DeltaDecoder decoder;
+    decoder.begin(copy);
+    int v, n = 0;
+    while (decoder.next(v)) {
+      n++;
+    }
+    if (n > copy[4]) {
+      errors++;
+    }
+    free(copy);
+  }
+  printf("%-8s %5d blocks %s\n", "garbage", rounds, errors == before ? "ok" : "FAILED");
+}
+
+// an erased EEPROM slot past its header: every nibble says another follows
+static void continuations() {
+  unsigned long before = errors;
+  uint8_t *copy = (uint8_t*)malloc(DELTA_BLOCK_SIZE);
+  memset(copy, 0xff, DELTA_BLOCK_SIZE);
+  copy[4] = 2;
+  DeltaDecoder decoder;
+  decoder.begin(copy);
+  int v, n = 0;
+  while (decoder.next(v)) {
+    n++;
+  }
+  if (n != 1) {
+    errors++;  // the key, then the run is corrupt
+  }
+  free(copy);
+  printf("%-8s %5d samples %s\n", "erased", n, errors == before ? "ok" : "FAILED");
+}
+
+int main() {
+  int dayBlocks = roundTrip("day", daySample, DAY_SAMPLES);
+  if (dayBlocks > DAY_BLOCKS) {
+    errors++;
+    fprintf(stderr, "day: %d blocks, expected at most %d\n", dayBlocks, DAY_BLOCKS);
+  }
+  srand(1);
+  roundTrip("extreme", extremeSample, 200);
+  roundTrip("random", randomSample, 2000);
+  roundTrip("ramp", rampSample, 5000);
+  garbage(10000);
+  continuations();
+
+  printf("errors: %lu\n", errors);
+  return errors ? 1 : 0;
+}
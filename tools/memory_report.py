@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+memory_report.py
+Static RAM per module of a sketch build: what each .ino and library puts in
+.data (initialised, also costs flash) and .bss (zeroed and .noinit).
+
+Symbols come from avr-nm with line numbers, so the .elf has to be built
+with debug info, which the Arduino IDE does. The IDE joins the .ino files
+into one .cpp but keeps #line directives, so sketch symbols are still
+credited to their own .ino. Symbols without a line (avr-libc, the core's
+assembler) are listed under "?".
+
+The free RAM it prints is what is left for the heap and the stack before
+anything runs; Memory.ino reports how much of that the stack actually used.
+
+Usage: memory_report.py [-r ram] [-s] build/openTerrarium.cpp.elf
+  -r  RAM size in bytes, 2048 for the ATmega328P
+  -s  also list the symbols of each module, largest first
+  The .elf is in the IDE's build folder, shown with verbose output on.
+"""
+
+import argparse
+import collections
+import os
+import subprocess
+import sys
+
+SECTIONS = {'d': 'data', 'D': 'data', 'b': 'bss', 'B': 'bss'}
+
+
+def read_symbols(elf, nm):
+    out = subprocess.run([nm, '--print-size', '--line-numbers', '--demangle', elf],
+                         check=True, stdout=subprocess.PIPE, universal_newlines=True).stdout
+    for line in out.splitlines():
+        where = '?'
+        if '\t' in line:
+            line, where = line.split('\t', 1)
+            where = os.path.basename(where.rsplit(':', 1)[0])
+        fields = line.split(None, 3)
+        if len(fields) < 4 or fields[2] not in SECTIONS:
+            continue  # no size or not in RAM
+        yield where, SECTIONS[fields[2]], int(fields[1], 16), fields[3]
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Static RAM per module of a sketch build.')
+    parser.add_argument('-r', '--ram', type=int, default=2048)
+    parser.add_argument('-s', '--symbols', action='store_true')
+    parser.add_argument('--nm', default='avr-nm')
+    parser.add_argument('elf')
+    args = parser.parse_args()
+
+    modules = collections.defaultdict(lambda: {'data': 0, 'bss': 0, 'symbols': []})
+    try:
+        for where, section, size, name in read_symbols(args.elf, args.nm):
+            modules[where][section] += size
+            modules[where]['symbols'].append((size, section, name))
+    except (OSError, subprocess.CalledProcessError) as e:
+        sys.exit('memory_report: %s' % e)
+
+    total = {'data': 0, 'bss': 0}
+    print('%-28s %6s %6s %6s' % ('module', 'data', 'bss', 'total'))
+    for where, m in sorted(modules.items(), key=lambda i: -(i[1]['data'] + i[1]['bss'])):
+        print('%-28s %6d %6d %6d' % (where, m['data'], m['bss'], m['data'] + m['bss']))
+        if args.symbols:
+            for size, section, name in sorted(m['symbols'], reverse=True):
+                print('    %-36s %-4s %5d' % (name, section, size))
+        total['data'] += m['data']
+        total['bss'] += m['bss']
+
+    used = total['data'] + total['bss']
+    print('%-28s %6d %6d %6d' % ('total', total['data'], total['bss'], used))
+    print('free for heap and stack: %d of %d' % (args.ram - used, args.ram))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,14 @@
+/*
+ * avr/interrupt.h - just enough of it for the host tests in tools/, there
+ * is no interrupt to hold off
+ */
+
+#ifndef host_avr_interrupt_h
+#define host_avr_interrupt_h
+
+#include <avr/io.h>
+
+#define cli()
+#define sei()
+
+#endif
@@ -0,0 +1,12 @@
+/*
+ * avr/io.h - just enough of it for the host tests in tools/
+ */
+
+#ifndef host_avr_io_h
+#define host_avr_io_h
+
+#include <stdint.h>
+
+extern uint8_t SREG;  // defined by the test
+
+#endif
@@ -0,0 +1,490 @@
+/*
+ * telemetry_decode.cpp
+ * Decodes the controller's binary telemetry (see Telemetry.ino) from a
+ * serial port or a captured file.
+ *
+ * Frames are COBS encoded between two 0x00, the empty frame between two
+ * records is skipped. A frame that does not decode
+ * to a known record version with a good CRC-8 is counted and skipped, the next
+ * 0x00 starts a fresh one, so captures may start mid frame or carry the
+ * protocol's replies in between. A run longer than any frame without a
+ * 0x00 is dropped as noise.
+ *
+ * Output, in the given directory:
+ *   time.u64 temp.i16 rtc_temp.i16 setpoint.i16 relay.u8 flags.u8 dropped.u8
+ *     one raw little endian column per field, a value per record
+ *   records.csv  the same as text, unless -n
+ *   daily.csv    a line per UTC day: records, temperature min/max/mean,
+ *                time within -b degrees of the setpoint, relay duty
+ *
+ * Build: g++ -O2 -o telemetry_decode tools/telemetry_decode.cpp
+ * Usage: telemetry_decode [-b band] [-n] [-o dir] [file|/dev/ttyUSB0]
+ *   reads stdin without a file. A tty is set to 115200 8N1 raw and read
+ *   until interrupted; Ctrl-C or SIGTERM still close the files and print
+ *   the totals.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// TelemetryRecord sizes without the CRC. v2 added the dropped count
+#define RECORD_V1_SIZE 15
+#define RECORD_V2_SIZE 16
+#define FRAME_MAX      254            // longest COBS block the sketch sends
+#define NO_VALUE       ((int16_t)0x8000)
+#define MS_PER_DAY     86400000ULL
+#define GAP_LIMIT      60000          // ms, a longer gap between records is not counted
+
+#define CHUNK_SIZE     (1 << 20)
+
+struct Record {
+  uint64_t time;    // ms since 1970
+  int16_t temp;     // 0.01*C
+  int16_t rtcTemp;
+  int16_t setpoint;
+  uint8_t relay;
+  uint8_t flags;
+  uint8_t dropped;  // records the controller could not send before this one
+};
+
+struct Stats {
+  unsigned long long bytes;
+  unsigned long long records;
+  unsigned long long badFrames;  // COBS errors or wrong length
+  unsigned long long badCrc;
+  unsigned long long badVersion;
+  unsigned long long dropped;    // reported by the controller
+};
+
+// Dallas/Maxim CRC-8, as OneWire::crc8()
+static uint8_t crcTable[256];
+
+static void initCrc() {
+  for (int i = 0; i < 256; i++) {
+    uint8_t crc = i;
+    for (int b = 0; b < 8; b++) {
+      crc = (crc & 1) ? (crc >> 1) ^ 0x8C : crc >> 1;
+    }
+    crcTable[i] = crc;
+  }
+}
+
+static uint8_t crc8(const uint8_t *data, size_t len) {
+  uint8_t crc = 0;
+  while (len--) {
+    crc = crcTable[crc ^ *data++];
+  }
+  return crc;
+}
+
+// returns the decoded length, or -1 if the block is not valid COBS
+static int cobsDecode(const uint8_t *in, size_t len, uint8_t *out) {
+  size_t i = 0;
+  int o = 0;
+  while (i < len) {
+    uint8_t code = in[i++];
+    if (code == 0 || i + code - 1 > len) {
+      return -1;
+    }
+    for (uint8_t k = 1; k < code; k++) {
+      out[o++] = in[i++];
+    }
+    if (code != 0xFF && i < len) {
+      out[o++] = 0;
+    }
+  }
+  return o;
+}
+
+/*
+  Column and CSV writers, buffered by stdio.
+*/
+class Output {
+public:
+  Output() : csv(NULL) { memset(columns, 0, sizeof(columns)); }
+
+  bool open(const char *dir, bool withCsv) {
+    static const char *names[COLUMNS] = {
+      "time.u64", "temp.i16", "rtc_temp.i16", "setpoint.i16", "relay.u8", "flags.u8", "dropped.u8"
+    };
+    for (int i = 0; i < COLUMNS; i++) {
+      if (!(columns[i] = openFile(dir, names[i]))) {
+        return false;
+      }
+    }
+    if (withCsv) {
+      if (!(csv = openFile(dir, "records.csv"))) {
+        return false;
+      }
+      fputs("time,temp,rtc_temp,setpoint,relay,flags,dropped\n", csv);
+    }
+    return true;
+  }
+
+  void write(const Record &r) {
+    putLe(columns[0], r.time, 8);
+    putLe(columns[1], (uint16_t)r.temp, 2);
+    putLe(columns[2], (uint16_t)r.rtcTemp, 2);
+    putLe(columns[3], (uint16_t)r.setpoint, 2);
+    fputc(r.relay, columns[4]);
+    fputc(r.flags, columns[5]);
+    fputc(r.dropped, columns[6]);
+
+    if (csv) {
+      char line[96];
+      char *p = line;
+      p = putTime(p, r.time);
+      *p++ = ',';
+      p = putTemp(p, r.temp);
+      *p++ = ',';
+      p = putTemp(p, r.rtcTemp);
+      *p++ = ',';
+      p = putTemp(p, r.setpoint);
+      *p++ = ',';
+      *p++ = '0' + (r.relay ? 1 : 0);
+      *p++ = ',';
+      p = putUnsigned(p, r.flags);
+      *p++ = ',';
+      p = putUnsigned(p, r.dropped);
+      *p++ = '\n';
+      fwrite(line, 1, p - line, csv);
+    }
+  }
+
+  bool close() {
+    bool ok = true;
+    for (int i = 0; i < COLUMNS; i++) {
+      ok &= columns[i] && fclose(columns[i]) == 0;
+    }
+    if (csv) {
+      ok &= fclose(csv) == 0;
+    }
+    return ok;
+  }
+
+  static FILE* openFile(const char *dir, const char *name) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+      fprintf(stderr, "%s: %s\n", path, strerror(errno));
+      return NULL;
+    }
+    setvbuf(f, NULL, _IOFBF, 1 << 16);
+    return f;
+  }
+
+  // ISO 8601 UTC with milliseconds
+  static char* putTime(char *p, uint64_t ms) {
+    time_t t = ms / 1000;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    p += strftime(p, 24, "%Y-%m-%dT%H:%M:%S", &tm);
+    unsigned frac = ms % 1000;
+    *p++ = '.';
+    *p++ = '0' + frac / 100;
+    *p++ = '0' + frac / 10 % 10;
+    *p++ = '0' + frac % 10;
+    *p++ = 'Z';
+    return p;
+  }
+
+  // 0.01*C as a decimal, empty when not available
+  static char* putTemp(char *p, int16_t v) {
+    if (v == NO_VALUE) {
+      return p;
+    }
+    int x = v;
+    if (x < 0) {
+      *p++ = '-';
+      x = -x;
+    }
+    p = putUnsigned(p, x / 100);
+    *p++ = '.';
+    *p++ = '0' + x / 10 % 10;
+    *p++ = '0' + x % 10;
+    return p;
+  }
+
+  static char* putUnsigned(char *p, unsigned v) {
+    char digits[10];
+    int n = 0;
+    do {
+      digits[n++] = '0' + v % 10;
+      v /= 10;
+    } while (v);
+    while (n) {
+      *p++ = digits[--n];
+    }
+    return p;
+  }
+
+private:
+  static void putLe(FILE *f, uint64_t v, int size) {
+    uint8_t b[8];
+    for (int i = 0; i < size; i++) {
+      b[i] = v >> (8 * i);
+    }
+    fwrite(b, 1, size, f);
+  }
+
+  enum { COLUMNS = 7 };
+  FILE *columns[COLUMNS];
+  FILE *csv;
+};
+
+/*
+  Per day summary. Each record stands for the time until the next one,
+  up to GAP_LIMIT, and is counted in the day it was taken.
+*/
+class DailySummary {
+public:
+  DailySummary(double band) : out(NULL), band(band * 100), day(0), havePrev(false) { reset(); }
+
+  bool open(const char *dir) {
+    if (!(out = Output::openFile(dir, "daily.csv"))) {
+      return false;
+    }
+    fputs("date,records,temp_min,temp_max,temp_mean,in_band_pct,relay_duty_pct,covered_pct\n", out);
+    return true;
+  }
+
+  void add(const Record &r) {
+    if (havePrev) {
+      uint64_t dt = r.time > prev.time ? r.time - prev.time : 0;
+      account(prev, dt > GAP_LIMIT ? 0 : dt);
+    }
+    prev = r;
+    havePrev = true;
+  }
+
+  bool close() {
+    if (havePrev) {
+      account(prev, 0);
+    }
+    flush();
+    return out && fclose(out) == 0;
+  }
+
+private:
+  void account(const Record &r, uint64_t dt) {
+    uint64_t d = r.time / MS_PER_DAY;
+    if (d != day) {
+      flush();
+      day = d;
+    }
+    records++;
+    covered += dt;
+    if (r.relay) {
+      relayOn += dt;
+    }
+    if (r.temp != NO_VALUE) {
+      if (r.temp < tempMin) tempMin = r.temp;
+      if (r.temp > tempMax) tempMax = r.temp;
+      tempSum += r.temp;
+      tempCount++;
+      if (r.setpoint != NO_VALUE && abs(r.temp - r.setpoint) <= band) {
+        inBand += dt;
+      }
+    }
+  }
+
+  void flush() {
+    if (records == 0) {
+      return;
+    }
+    time_t t = day * 86400;
+    struct tm tm;
+    char date[16];
+    gmtime_r(&t, &tm);
+    strftime(date, sizeof(date), "%Y-%m-%d", &tm);
+
+    double span = covered ? covered : 1;
+    fprintf(out, "%s,%llu,", date, records);
+    if (tempCount) {
+      fprintf(out, "%.2f,%.2f,%.2f,", tempMin / 100.0, tempMax / 100.0, tempSum / 100.0 / tempCount);
+    }
+    else {
+      fputs(",,,", out);
+    }
+    fprintf(out, "%.1f,%.1f,%.1f\n", 100 * inBand / span, 100 * relayOn / span, 100.0 * covered / MS_PER_DAY);
+    reset();
+  }
+
+  void reset() {
+    records = tempCount = 0;
+    covered = inBand = relayOn = 0;
+    tempMin = INT16_MAX;
+    tempMax = INT16_MIN;
+    tempSum = 0;
+  }
+
+  FILE *out;
+  int band;
+  uint64_t day;
+  Record prev;
+  bool havePrev;
+
+  unsigned long long records, tempCount;
+  uint64_t covered, inBand, relayOn;
+  int tempMin, tempMax;
+  long long tempSum;
+};
+
+static bool parseRecord(const uint8_t *frame, size_t len, Record &r, Stats &stats) {
+  uint8_t data[FRAME_MAX];
+  int size = len > FRAME_MAX ? -1 : cobsDecode(frame, len, data) - 1;
+  if (size < 1) {
+    stats.badFrames++;
+    return false;
+  }
+  if (crc8(data, size) != data[size]) {
+    stats.badCrc++;
+    return false;
+  }
+  if (!(data[0] == 1 && size == RECORD_V1_SIZE) && !(data[0] == 2 && size == RECORD_V2_SIZE)) {
+    stats.badVersion++;
+    return false;
+  }
+
+  r.time = 0;
+  for (int i = 0; i < 6; i++) {
+    r.time |= (uint64_t)data[1 + i] << (8 * i);
+  }
+  r.temp = (int16_t)(data[7] | data[8] << 8);
+  r.rtcTemp = (int16_t)(data[9] | data[10] << 8);
+  r.setpoint = (int16_t)(data[11] | data[12] << 8);
+  r.relay = data[13];
+  r.flags = data[14];
+  r.dropped = data[0] >= 2 ? data[15] : 0;
+  stats.records++;
+  stats.dropped += r.dropped;
+  return true;
+}
+
+static bool setupTty(int fd) {
+  struct termios tio;
+  if (tcgetattr(fd, &tio) != 0) {
+    return false;
+  }
+  cfmakeraw(&tio);
+  cfsetispeed(&tio, B115200);
+  cfsetospeed(&tio, B115200);
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  return tcsetattr(fd, TCSANOW, &tio) == 0;
+}
+
+static volatile sig_atomic_t stopping;
+
+static void stop(int) {
+  stopping = 1;
+}
+
+// no SA_RESTART: a signal ends a blocking read with EINTR
+static void catchSignals() {
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = stop;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+}
+
+static void usage() {
+  fputs("usage: telemetry_decode [-b band] [-n] [-o dir] [file|tty]\n"
+        "  -b  degrees from the setpoint counted as in band, default 0.5\n"
+        "  -n  no records.csv\n"
+        "  -o  output directory, default .\n", stderr);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  const char *dir = ".";
+  double band = 0.5;
+  bool withCsv = true;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "b:no:")) != -1) {
+    switch (opt) {
+    case 'b': band = atof(optarg); break;
+    case 'n': withCsv = false; break;
+    case 'o': dir = optarg; break;
+    default: usage();
+    }
+  }
+  if (argc - optind > 1) {
+    usage();
+  }
+
+  int fd = 0;
+  if (optind < argc) {
+    fd = open(argv[optind], O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+      fprintf(stderr, "%s: %s\n", argv[optind], strerror(errno));
+      return 1;
+    }
+  }
+  if (isatty(fd) && !setupTty(fd)) {
+    fprintf(stderr, "cannot set up the serial port: %s\n", strerror(errno));
+    return 1;
+  }
+
+  mkdir(dir, 0777);
+  initCrc();
+  Output output;
+  DailySummary daily(band);
+  if (!output.open(dir, withCsv) || !daily.open(dir)) {
+    return 1;
+  }
+
+  Stats stats;
+  memset(&stats, 0, sizeof(stats));
+  static uint8_t buf[CHUNK_SIZE + FRAME_MAX + 1];
+  size_t pending = 0;   // bytes of an unfinished frame at the start of buf
+  ssize_t n;
+
+  catchSignals();
+  while (!stopping && (n = read(fd, buf + pending, CHUNK_SIZE)) != 0) {
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      fprintf(stderr, "read: %s\n", strerror(errno));
+      break;
+    }
+    stats.bytes += n;
+    const uint8_t *p = buf;
+    const uint8_t *end = buf + pending + n;
+    const uint8_t *zero;
+
+    while ((zero = (const uint8_t*)memchr(p, 0, end - p)) != NULL) {
+      Record r;
+      if (zero > p && parseRecord(p, zero - p, r, stats)) {
+        output.write(r);
+        daily.add(r);
+      }
+      p = zero + 1;
+    }
+
+    pending = end - p;
+    if (pending > FRAME_MAX) {
+      // no delimiter for longer than any frame: noise, drop it
+      stats.badFrames++;
+      pending = 0;
+    }
+    memmove(buf, p, pending);
+  }
+
+  bool ok = output.close() & daily.close();
+  fprintf(stderr, "%llu bytes, %llu records, %llu bad frames, %llu crc errors, %llu unknown versions, %llu dropped by the controller\n",
+          stats.bytes, stats.records, stats.badFrames, stats.badCrc, stats.badVersion, stats.dropped);
+  return ok ? 0 : 1;
+}